@@ -0,0 +1,729 @@
+#define _GNU_SOURCE  // For sched_setaffinity()
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mman.h>  // For shm_unlink()
+#include <time.h>
+#include "stats_functions.h"
+#include "shm_snapshot.h"
+#include "series_store.h"
+
+// Accuracy and overhead harness: starts controlled synthetic load and checks that
+// sys_stats reports it, then measures what sys_stats itself costs.
+//
+// The accuracy checks run one sys_stats process under test, sampling every
+// MONITOR_INTERVAL_S, and read what it reports: its --shm segment for total CPU
+// usage, memory and the session count, its --record recording for per-core usage
+// and its output for the session list. It is stopped with Ctrl-C, like a user would.
+//
+//  - CPU: a burner pinned to each CPU the harness may use runs at known duty cycles;
+//    the total usage and the usage of one core must match the duty cycle. Both are
+//    the values the CPU section displays, computed by calculate_cpu_usage().
+//  - Memory: an allocator grows its resident memory at a known rate; the change in
+//    reported memory must match the amount and the rate. The kernel does not count
+//    pages cached on its per-CPU free lists as free, and new allocations use those
+//    pages first, so the measurement starts after a warm-up allocation.
+//  - Sessions: sys_stats reads a fixture utmp file with known sessions. This needs
+//    the test build (make loadtest builds bench/sys_stats_test), which reads sessions
+//    from the file named by SYS_STATS_UTMP.
+//  - Overhead: sys_stats runs at 1 s, 100 ms and 10 ms intervals, with the default
+//    collectors and with graphics, interrupts and a watched process, while a burner
+//    keeps one CPU half busy; its CPU time and its latency per tick must stay within budget.
+//
+// Every check prints PASS or FAIL; the exit status is nonzero if any check failed.
+//
+// Usage: bench/load_harness [path to a test build of sys_stats]
+
+// Segment the sys_stats under test publishes to
+#define MONITOR_SHM_NAME "/sys_stats_loadtest"
+
+// Sampling interval of the sys_stats under test
+#define MONITOR_TDELAY "0.1"
+#define MONITOR_INTERVAL_S 0.1
+
+// Longest wait for the sys_stats under test to publish its next sample
+#define MONITOR_TIMEOUT_S 5.0
+
+// Longest the burner sleeps at a time
+#define BURN_SLICE_S 0.001
+
+// Window over which CPU usage is averaged, after a short warm-up
+#define CPU_WINDOW_S 1.0
+#define CPU_WARMUP_S 0.2
+
+// Largest accepted error of a CPU measurement, in percentage points. A step must also
+// move the usage by more than this and stay this far below 100%, or it proves nothing.
+#define CPU_TOLERANCE 8.0
+
+// Duty cycles the burners run at, after an idle baseline, in percent of the idle time
+// left at the baseline, so the loaded usage never reaches 100% and gets clamped
+#define CPU_DUTY_COUNT 3
+static const double cpu_duties[CPU_DUTY_COUNT] = {25.0, 50.0, 75.0};
+
+// The allocator grows by MEM_WARMUP_MB, then by the measured MEM_GROW_MB, at MEM_GROW_MB_PER_S
+#define MEM_WARMUP_MB 128
+#define MEM_GROW_MB 256
+#define MEM_GROW_MB_PER_S 256.0
+
+// Largest accepted error of a memory measurement: the larger of an absolute and a relative bound
+#define MEM_TOLERANCE_MB 24.0
+#define MEM_TOLERANCE_RATIO 0.15
+
+// Most samples kept while the allocator grows
+#define MEM_MAX_SAMPLES 256
+
+// Sessions in the utmp fixture; other record types are mixed in and must be skipped
+#define FIXTURE_SESSIONS 5
+
+// An overhead run: sampling interval, number of samples, collectors and budgets.
+// Budgets are about three times the cost measured on a 1-CPU VM, so a regression
+// of that size fails the run.
+typedef struct {
+    const char *tdelay;  // --tdelay argument
+    double interval;  // Same, in seconds
+    int samples;  // --samples argument
+    int heavy;  // Also run graphics, interrupts and the processes collector (watching the burner)
+    double cpu_budget;  // Largest accepted CPU use of sys_stats, in percent of one core
+    double latency_budget_ms;  // Largest accepted time per tick beyond the interval
+} OverheadRun;
+
+static const OverheadRun overhead_runs[] = {
+    {"1", 1.0, 3, 0, 0.5, 10.0},
+    {"0.1", 0.1, 20, 0, 2.0, 5.0},
+    {"0.01", 0.01, 100, 0, 10.0, 3.0},
+    {"0.1", 0.1, 20, 1, 3.0, 5.0},
+    {"0.01", 0.01, 100, 1, 15.0, 3.0},
+};
+
+// A sys_stats process under test and how its reports are read
+typedef struct {
+    pid_t pid;  // The process
+    int stdin_fd;  // Write end of its standard input, to answer the Ctrl-C prompt
+    const SharedSegment *segment;  // Its --shm segment
+    uint64_t next_index;  // Smallest sample_index not read yet
+    char record_path[64];  // Its --record recording
+    char output_path[64];  // Its standard output
+    char utmp_path[64];  // The utmp fixture it reads sessions from
+} Monitor;
+
+// Window of samples one CPU measurement was averaged over
+typedef struct {
+    double duty;  // Duty cycle the burners ran at, in percent of a core (0 for the baseline)
+    int64_t first_ms;  // Timestamp of the first sample
+    int64_t last_ms;  // Timestamp of the last sample
+    double total_usage;  // Mean total usage reported over the window
+} CpuWindow;
+
+// Number of failed checks
+static int failures;
+
+/**
+ * Returns CLOCK_MONOTONIC in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns CLOCK_REALTIME in seconds, the clock sample timestamps are taken on.
+ */
+static double realtime_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Sleeps for a number of seconds.
+ */
+static void sleep_seconds(double seconds) {
+    struct timespec ts = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+/**
+ * Records and prints the outcome of one check.
+ */
+static void check(int ok, const char *what, double measured, double expected, const char *unit) {
+    printf("%s  %-44s measured %8.2f%s, expected %8.2f%s\n", ok ? "PASS" : "FAIL", what, measured, unit, expected, unit);
+    failures += !ok;
+}
+
+/**
+ * Creates an empty temporary file from a template ending in XXXXXX.
+ */
+static void make_temp_file(char *path) {
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("mkstemp");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+}
+
+/**
+ * Returns the first CPU the harness is allowed to run on.
+ */
+static int first_allowed_cpu(void) {
+    cpu_set_t allowed;
+    int cpu = 0;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        while (cpu < CPU_SETSIZE - 1 && !CPU_ISSET(cpu, &allowed)) {
+            cpu++;
+        }
+    }
+    return cpu;
+}
+
+/**
+ * Forks a process pinned to cpu that keeps it busy duty percent of the time, until
+ * killed. The burner compares its own CPU time with the wall time since it started
+ * and spins whenever it is behind, otherwise sleeps for a slice, so late wakeups
+ * are made up for and the duty cycle holds over any window of a few slices.
+ */
+static pid_t start_burner(int cpu, double duty) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid > 0) {
+        return pid;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        perror("sched_setaffinity");
+        _exit(EXIT_FAILURE);
+    }
+    struct timespec cpu_time;
+    double start = now_seconds();
+    for (;;) {
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time);
+        double busy = cpu_time.tv_sec + cpu_time.tv_nsec / 1e9;
+        if (busy < (now_seconds() - start) * duty / 100.0) {
+            continue; // Behind the duty cycle: keep burning
+        }
+        sleep_seconds(BURN_SLICE_S);
+    }
+}
+
+/**
+ * Starts a burner at duty percent on every CPU in allowed; pids receives one process
+ * per CPU. Returns the number of burners started.
+ */
+static int start_burners(const cpu_set_t *allowed, double duty, pid_t *pids) {
+    int n = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, allowed)) {
+            pids[n++] = start_burner(cpu, duty);
+        }
+    }
+    return n;
+}
+
+/**
+ * Kills and reaps a load process.
+ */
+static void stop_load(pid_t pid) {
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+/**
+ * Writes a utmp fixture with FIXTURE_SESSIONS user sessions "loadK" on pts/K from
+ * 10.0.0.K+1, between records of other types.
+ */
+static void write_utmp_fixture(const char *path) {
+    int fd = open(path, O_WRONLY | O_TRUNC);
+    if (fd == -1) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    for (int k = 0; k < FIXTURE_SESSIONS; k++) {
+        struct utmp records[2];
+        memset(records, 0, sizeof(records));
+        records[0].ut_type = k % 2 ? DEAD_PROCESS : LOGIN_PROCESS; // Must be skipped
+        snprintf(records[0].ut_line, sizeof(records[0].ut_line), "tty%d", k);
+        records[1].ut_type = USER_PROCESS;
+        records[1].ut_pid = 1000 + k;
+        snprintf(records[1].ut_user, sizeof(records[1].ut_user), "load%d", k);
+        snprintf(records[1].ut_line, sizeof(records[1].ut_line), "pts/%d", k);
+        snprintf(records[1].ut_host, sizeof(records[1].ut_host), "10.0.0.%d", k + 1);
+        if (write(fd, records, sizeof(records)) != (ssize_t)sizeof(records)) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(fd);
+}
+
+/**
+ * Starts sys_stats sampling every MONITOR_INTERVAL_S into a shared memory segment
+ * and a recording, reading sessions from a utmp fixture, and waits for its segment.
+ */
+static void start_monitor(Monitor *monitor, const char *sys_stats) {
+    memset(monitor, 0, sizeof(*monitor));
+    snprintf(monitor->record_path, sizeof(monitor->record_path), "/tmp/sys_stats_record_XXXXXX");
+    snprintf(monitor->output_path, sizeof(monitor->output_path), "/tmp/sys_stats_output_XXXXXX");
+    snprintf(monitor->utmp_path, sizeof(monitor->utmp_path), "/tmp/sys_stats_utmp_XXXXXX");
+    make_temp_file(monitor->record_path);
+    make_temp_file(monitor->output_path);
+    make_temp_file(monitor->utmp_path);
+    write_utmp_fixture(monitor->utmp_path);
+    shm_unlink(MONITOR_SHM_NAME); // Left behind by an interrupted harness run
+
+    char shm_arg[64], record_arg[96];
+    snprintf(shm_arg, sizeof(shm_arg), "--shm=%s", MONITOR_SHM_NAME);
+    snprintf(record_arg, sizeof(record_arg), "--record=%s", monitor->record_path);
+
+    int input[2];
+    if (pipe(input) != 0) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    monitor->pid = fork();
+    if (monitor->pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (monitor->pid == 0) {
+        int output_fd = open(monitor->output_path, O_WRONLY);
+        dup2(input[0], STDIN_FILENO);
+        dup2(output_fd, STDOUT_FILENO);
+        close(input[1]);
+        setenv("SYS_STATS_UTMP", monitor->utmp_path, 1);
+        execl(sys_stats, sys_stats, "--sequential", "--samples", "1000000", "--tdelay", MONITOR_TDELAY,
+              shm_arg, record_arg, (char *)NULL);
+        perror(sys_stats);
+        _exit(127);
+    }
+    close(input[0]);
+    monitor->stdin_fd = input[1];
+
+    double deadline = now_seconds() + MONITOR_TIMEOUT_S;
+    while (!(monitor->segment = shm_snapshot_open(MONITOR_SHM_NAME))) {
+        if ((errno != ENOENT && errno != EAGAIN) || now_seconds() > deadline) {
+            perror("Failed to open the segment of sys_stats");
+            exit(EXIT_FAILURE);
+        }
+        sleep_seconds(0.001);
+    }
+}
+
+/**
+ * Waits for the next sample sys_stats publishes after the latest one read.
+ */
+static void next_sample(Monitor *monitor, SharedSample *sample) {
+    double deadline = now_seconds() + MONITOR_TIMEOUT_S;
+    for (;;) {
+        // A failed read counts as no new sample; the deadline covers a stuck writer
+        if (shm_snapshot_read(monitor->segment, sample) >= 0 && sample->flags != 0 && sample->sample_index >= monitor->next_index) {
+            monitor->next_index = sample->sample_index + 1;
+            return;
+        }
+        if (now_seconds() > deadline) {
+            fprintf(stderr, "sys_stats stopped publishing samples\n");
+            exit(EXIT_FAILURE);
+        }
+        sleep_seconds(0.001);
+    }
+}
+
+/**
+ * Stops sys_stats the way a user does, with Ctrl-C answered by "y", and checks
+ * that it exits cleanly. Its recording and output stay for inspection.
+ */
+static void stop_monitor(Monitor *monitor) {
+    int status;
+    shm_snapshot_close(monitor->segment);
+    if (write(monitor->stdin_fd, "y\n", 2) != 2) {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+    kill(monitor->pid, SIGINT);
+    if (waitpid(monitor->pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "sys_stats did not exit cleanly on Ctrl-C\n");
+        exit(EXIT_FAILURE);
+    }
+    close(monitor->stdin_fd);
+}
+
+/**
+ * Removes the files of a stopped sys_stats.
+ */
+static void remove_monitor_files(const Monitor *monitor) {
+    unlink(monitor->record_path);
+    unlink(monitor->output_path);
+    unlink(monitor->utmp_path);
+}
+
+/**
+ * Averages the total CPU usage sys_stats reports over CPU_WINDOW_S. The first sample
+ * is skipped, since its interval may have started before the load changed.
+ */
+static void measure_cpu_window(Monitor *monitor, CpuWindow *window) {
+    SharedSample sample;
+    int count = (int)round(CPU_WINDOW_S / MONITOR_INTERVAL_S);
+    double sum = 0.0;
+
+    next_sample(monitor, &sample);
+    for (int k = 0; k < count; k++) {
+        next_sample(monitor, &sample);
+        if (k == 0) {
+            window->first_ms = sample.timestamp_ns / 1000000;
+        }
+        sum += sample.cpu_usage;
+    }
+    window->last_ms = sample.timestamp_ns / 1000000;
+    window->total_usage = sum / count;
+}
+
+/**
+ * Checks one CPU measurement against the expected usage, unless the step from the
+ * baseline is too small to tell from the tolerance or the expected usage is too
+ * close to 100%, which also fails: such a step would pass without measuring anything.
+ */
+static void check_cpu_step(const char *what, double measured, double base, double expected) {
+    if (expected - base <= CPU_TOLERANCE || expected >= 100.0 - CPU_TOLERANCE) {
+        printf("FAIL  %-44s cannot be measured: expected %.2f%% from a baseline of %.2f%%\n", what, expected, base);
+        failures++;
+        return;
+    }
+    check(fabs(measured - expected) <= CPU_TOLERANCE, what, measured, expected, "%");
+}
+
+/**
+ * Runs a burner on every CPU the harness may use, at several duty cycles, and checks
+ * the total usage published in the shared memory segment against the idle baseline
+ * plus the duty cycle, scaled by the share of online CPUs that are burned. windows
+ * receives the baseline, then one window per duty cycle.
+ */
+static void check_cpu_totals(Monitor *monitor, CpuWindow windows[CPU_DUTY_COUNT + 1]) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        perror("sched_getaffinity");
+        exit(EXIT_FAILURE);
+    }
+    int n_online = sysconf(_SC_NPROCESSORS_ONLN);
+    int n_burned = MIN(CPU_COUNT(&allowed), n_online);
+    pid_t *burners = malloc(CPU_COUNT(&allowed) * sizeof(pid_t));
+    if (!burners) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("### CPU: burners on %d of %d online CPUs ###\n", n_burned, n_online);
+    measure_cpu_window(monitor, &windows[0]);
+    double base = windows[0].total_usage;
+    for (int k = 0; k < CPU_DUTY_COUNT; k++) {
+        double duty = cpu_duties[k] * (100.0 - base) / 100.0;
+        int n = start_burners(&allowed, duty, burners);
+        sleep_seconds(CPU_WARMUP_S);
+        measure_cpu_window(monitor, &windows[k + 1]);
+        windows[k + 1].duty = duty;
+        for (int b = 0; b < n; b++) {
+            stop_load(burners[b]);
+        }
+
+        char what[64];
+        snprintf(what, sizeof(what), "published total usage at %.0f%% of idle", cpu_duties[k]);
+        check_cpu_step(what, windows[k + 1].total_usage, base, base + duty * n_burned / n_online);
+    }
+    free(burners);
+}
+
+/**
+ * Decodes the recording of a stopped sys_stats and checks the usage of one burned
+ * core in every window against its baseline window plus the duty cycle.
+ */
+static void check_cpu_cores(const Monitor *monitor, int cpu, const CpuWindow windows[CPU_DUTY_COUNT + 1]) {
+    double sums[CPU_DUTY_COUNT + 1] = {0};
+    int counts[CPU_DUTY_COUNT + 1] = {0};
+
+    SeriesReader *reader = series_reader_open(monitor->record_path);
+    if (!reader) {
+        perror("Failed to open the recording of sys_stats");
+        exit(EXIT_FAILURE);
+    }
+    int n_series = series_reader_series_count(reader);
+    int series = SERIES_FIXED_COUNT + cpu;
+    const SeriesBlockHeader *header;
+    while ((header = series_reader_next_block(reader, NULL)) != NULL) {
+        int64_t *timestamps = malloc(header->count * sizeof(int64_t));
+        double *values = malloc((size_t)header->count * n_series * sizeof(double));
+        if (!timestamps || !values || series >= n_series || series_reader_decode_block(reader, timestamps, values) != 0) {
+            fprintf(stderr, "The recording of sys_stats has no usable series for CPU%d\n", cpu);
+            exit(EXIT_FAILURE);
+        }
+        for (uint32_t i = 0; i < header->count; i++) {
+            for (int w = 0; w <= CPU_DUTY_COUNT; w++) {
+                if (timestamps[i] >= windows[w].first_ms && timestamps[i] <= windows[w].last_ms) {
+                    sums[w] += values[(size_t)i * n_series + series];
+                    counts[w]++;
+                }
+            }
+        }
+        free(timestamps);
+        free(values);
+    }
+    series_reader_close(reader);
+
+    for (int w = 0; w <= CPU_DUTY_COUNT; w++) {
+        if (counts[w] == 0) {
+            fprintf(stderr, "The recording of sys_stats misses the samples of a CPU window\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    double base = sums[0] / counts[0];
+    for (int k = 0; k < CPU_DUTY_COUNT; k++) {
+        char what[64];
+        double core = sums[k + 1] / counts[k + 1];
+        snprintf(what, sizeof(what), "recorded CPU%d usage at %.0f%% of idle", cpu, cpu_duties[k]);
+        check_cpu_step(what, core, base, base + windows[k + 1].duty);
+    }
+}
+
+/**
+ * Forks a process that grows its resident memory by MEM_WARMUP_MB, writes a byte to
+ * report_fd and waits for a byte on go_fd, then grows by MEM_GROW_MB at
+ * MEM_GROW_MB_PER_S, one touched megabyte at a time. It writes the CLOCK_REALTIME
+ * time it finished to report_fd, then waits to be killed.
+ */
+static pid_t start_allocator(int report_fd, int go_fd) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid > 0) {
+        return pid;
+    }
+
+    size_t mb = 1024 * 1024;
+    double start = 0.0;
+    char byte;
+    for (int k = 1; k <= MEM_WARMUP_MB + MEM_GROW_MB; k++) {
+        char *block = malloc(mb);
+        if (!block) {
+            _exit(EXIT_FAILURE);
+        }
+        memset(block, k, mb); // Touch every page so it becomes resident
+        if (k == MEM_WARMUP_MB) {
+            if (write(report_fd, "", 1) != 1 || read(go_fd, &byte, 1) != 1) {
+                _exit(EXIT_FAILURE);
+            }
+            start = now_seconds();
+        } else if (k > MEM_WARMUP_MB) {
+            double due = start + (k - MEM_WARMUP_MB) / MEM_GROW_MB_PER_S;
+            double now = now_seconds();
+            if (due > now) {
+                sleep_seconds(due - now);
+            }
+        }
+    }
+    double finished = realtime_seconds();
+    if (write(report_fd, &finished, sizeof(finished)) != (ssize_t)sizeof(finished)) {
+        _exit(EXIT_FAILURE);
+    }
+    for (;;) {
+        pause();
+    }
+}
+
+/**
+ * Checks that the memory sys_stats publishes follows the allocator's growth after
+ * the warm-up: the amount from samples taken before and after it, and the rate
+ * from the first and last samples taken while it grew.
+ */
+static void check_memory_accuracy(Monitor *monitor) {
+    int report[2], go[2];
+    SharedSample before, after, samples[MEM_MAX_SAMPLES];
+    int n_samples = 0;
+    double finished;
+    char byte;
+
+    printf("### Memory: allocator growing %d MB at %.0f MB/s ###\n", MEM_GROW_MB, MEM_GROW_MB_PER_S);
+    if (pipe(report) != 0 || pipe(go) != 0) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    pid_t allocator = start_allocator(report[1], go[0]);
+    if (read(report[0], &byte, 1) != 1) {
+        fprintf(stderr, "Allocator failed\n");
+        exit(EXIT_FAILURE);
+    }
+    // The second sample after the warm-up was taken entirely after it
+    next_sample(monitor, &before);
+    next_sample(monitor, &before);
+
+    double started = realtime_seconds();
+    if (write(go[1], "", 1) != 1) {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+    struct pollfd done = {report[0], POLLIN, 0};
+    while (poll(&done, 1, 0) == 0) {
+        if (n_samples == MEM_MAX_SAMPLES) {
+            fprintf(stderr, "Allocator did not finish\n");
+            exit(EXIT_FAILURE);
+        }
+        next_sample(monitor, &samples[n_samples++]);
+    }
+    if (read(report[0], &finished, sizeof(finished)) != (ssize_t)sizeof(finished)) {
+        fprintf(stderr, "Allocator failed\n");
+        exit(EXIT_FAILURE);
+    }
+    do {
+        next_sample(monitor, &after);
+    } while (after.timestamp_ns / 1e9 < finished + MONITOR_INTERVAL_S);
+    stop_load(allocator);
+    close(report[0]);
+    close(report[1]);
+    close(go[0]);
+    close(go[1]);
+
+    double grown_mb = (after.memory.phys_used - before.memory.phys_used) * 1024.0;
+    check(fabs(grown_mb - MEM_GROW_MB) <= fmax(MEM_TOLERANCE_MB, MEM_TOLERANCE_RATIO * MEM_GROW_MB),
+          "published physical memory growth", grown_mb, MEM_GROW_MB, " MB");
+
+    // Rate between the first and last samples taken while the allocator grew
+    const SharedSample *first = NULL, *last = NULL;
+    for (int k = 0; k < n_samples; k++) {
+        double taken = samples[k].timestamp_ns / 1e9;
+        if (taken > started && taken < finished) {
+            first = first ? first : &samples[k];
+            last = &samples[k];
+        }
+    }
+    double rate = 0.0, span = 0.0;
+    if (first && last != first) {
+        span = (last->timestamp_ns - first->timestamp_ns) / 1e9;
+        rate = (last->memory.phys_used - first->memory.phys_used) * 1024.0 / span;
+    }
+    check(span > 0 && fabs(rate - MEM_GROW_MB_PER_S) <= MEM_TOLERANCE_RATIO * MEM_GROW_MB_PER_S + MEM_TOLERANCE_MB / span,
+          "published physical memory growth rate", rate, MEM_GROW_MB_PER_S, " MB/s");
+}
+
+/**
+ * Checks the session count sys_stats publishes for the utmp fixture.
+ */
+static void check_session_count(Monitor *monitor) {
+    SharedSample sample;
+    printf("### Sessions: utmp fixture with %d sessions ###\n", FIXTURE_SESSIONS);
+    next_sample(monitor, &sample);
+    check(sample.session_count == FIXTURE_SESSIONS, "published session count", sample.session_count, FIXTURE_SESSIONS, "");
+}
+
+/**
+ * Checks that the last session list sys_stats printed holds exactly the fixture's
+ * sessions, in order.
+ */
+static void check_session_list(const Monitor *monitor) {
+    FILE *output = fopen(monitor->output_path, "r");
+    if (!output) {
+        perror(monitor->output_path);
+        exit(EXIT_FAILURE);
+    }
+    char line[1024], expected[128];
+    int n_listed = 0, in_list = 0, in_order = 0;
+    while (fgets(line, sizeof(line), output)) {
+        if (strcmp(line, "### Sessions/users ###\n") == 0) {
+            in_list = 1;
+            in_order = 1;
+            n_listed = 0;
+        } else if (in_list && strchr(line, '\t')) {
+            snprintf(expected, sizeof(expected), "load%d\tpts/%d\t(10.0.0.%d)\n", n_listed, n_listed, n_listed + 1);
+            in_order &= strcmp(line, expected) == 0;
+            n_listed++;
+        } else {
+            in_list = 0;
+        }
+    }
+    fclose(output);
+
+    int matches = in_order && n_listed == FIXTURE_SESSIONS;
+    check(matches, "printed sessions match the fixture", matches, 1, "");
+}
+
+/**
+ * Runs sys_stats for one overhead run with its output discarded and checks its CPU
+ * use and its latency per tick beyond the sampling interval.
+ */
+static void check_overhead(const char *sys_stats, const OverheadRun *run, pid_t burner) {
+    char samples[16], watch[32];
+    struct rusage usage;
+    snprintf(samples, sizeof(samples), "%d", run->samples);
+    snprintf(watch, sizeof(watch), "--watch=%d", (int)burner);
+
+    double start = now_seconds();
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        if (run->heavy) {
+            execl(sys_stats, sys_stats, "--sequential", "--samples", samples, "--tdelay", run->tdelay,
+                  "--graphics", "--interrupts", watch, (char *)NULL);
+        } else {
+            execl(sys_stats, sys_stats, "--sequential", "--samples", samples, "--tdelay", run->tdelay, (char *)NULL);
+        }
+        perror(sys_stats);
+        _exit(127);
+    }
+    int status;
+    if (wait4(pid, &status, 0, &usage) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s did not run successfully\n", sys_stats);
+        exit(EXIT_FAILURE);
+    }
+    double wall = now_seconds() - start;
+    double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+
+    char what[64];
+    const char *collectors = run->heavy ? "-g -i --watch" : "default";
+    snprintf(what, sizeof(what), "CPU use at %ss (%s)", run->tdelay, collectors);
+    check(100.0 * cpu / wall <= run->cpu_budget, what, 100.0 * cpu / wall, run->cpu_budget, "%");
+    double latency_ms = (wall / run->samples - run->interval) * 1e3;
+    snprintf(what, sizeof(what), "latency per tick at %ss (%s)", run->tdelay, collectors);
+    check(latency_ms <= run->latency_budget_ms, what, latency_ms, run->latency_budget_ms, " ms");
+}
+
+int main(int argc, char *argv[]) {
+    const char *sys_stats = argc > 1 ? argv[1] : "bench/sys_stats_test";
+    if (access(sys_stats, X_OK) != 0) {
+        fprintf(stderr, "Usage: %s [path to a test build of sys_stats]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Accuracy: one sys_stats under test reports all of the synthetic load
+    Monitor monitor;
+    CpuWindow cpu_windows[CPU_DUTY_COUNT + 1];
+    int cpu = first_allowed_cpu();
+    start_monitor(&monitor, sys_stats);
+    check_cpu_totals(&monitor, cpu_windows);
+    check_memory_accuracy(&monitor);
+    check_session_count(&monitor);
+    stop_monitor(&monitor);
+    check_cpu_cores(&monitor, cpu, cpu_windows);
+    check_session_list(&monitor);
+    remove_monitor_files(&monitor);
+
+    printf("### Overhead: sys_stats under a 50%% burner (budgets are maxima) ###\n");
+    pid_t burner = start_burner(cpu, 50.0);
+    for (size_t k = 0; k < sizeof(overhead_runs) / sizeof(overhead_runs[0]); k++) {
+        check_overhead(sys_stats, &overhead_runs[k], burner);
+    }
+    stop_load(burner);
+
+    printf("%s: %d check(s) failed\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
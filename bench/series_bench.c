@@ -0,0 +1,170 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "series_store.h"
+
+// Benchmark for the compressed recording format. It synthesizes a trace shaped like
+// what sys_stats records (1 s ticks with scheduling jitter, per-core usage measured
+// in whole clock ticks, slowly drifting memory counted in 4 KiB pages), encodes it,
+// decodes it back, checks the round trip bit for bit and runs a range query.
+//
+// Usage: bench/series_bench [samples] [cores]
+
+#define BENCH_RECORDING "/tmp/sys_stats_series_bench.rec"
+
+/**
+ * Returns a monotonic timestamp in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Small deterministic generator (xorshift64) so every run encodes the same trace.
+ */
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/**
+ * Fills timestamps[samples] and values[samples * n_series] with a realistic trace.
+ */
+static void generate_trace(int samples, int cores, int64_t *timestamps, double *values) {
+    int n_series = SERIES_FIXED_COUNT + cores;
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    int64_t now_ms = 1700000000000ll;
+    const double page_gb = 4096.0 / (1024 * 1024 * 1024);
+    long used_pages = 1572864, total_pages = 4029153, swap_pages = 251658;
+    int busy[cores];
+    memset(busy, 0, sizeof(busy));
+
+    for (int i = 0; i < samples; i++) {
+        double *sample = values + (size_t)i * n_series;
+
+        // One second plus a few milliseconds of scheduling jitter
+        now_ms += 1000 + (int64_t)(next_random(&rng) % 4);
+        timestamps[i] = now_ms;
+
+        // Each core is busy for a whole number of its 100 ticks per second
+        int busy_sum = 0;
+        for (int c = 0; c < cores; c++) {
+            busy[c] += (int)(next_random(&rng) % 7) - 3;
+            busy[c] = busy[c] < 0 ? 0 : (busy[c] > 100 ? 100 : busy[c]);
+            busy_sum += busy[c];
+            sample[SERIES_FIXED_COUNT + c] = busy[c];
+        }
+        sample[0] = round(100.0 * busy_sum / cores) / 100.0;
+
+        // Memory drifts by a few hundred pages; sysinfo() counts whole pages
+        used_pages += (long)(next_random(&rng) % 513) - 256;
+        used_pages = used_pages < 262144 ? 262144 : (used_pages > total_pages ? total_pages : used_pages);
+        sample[1] = used_pages * page_gb;
+        sample[2] = total_pages * page_gb;
+        sample[3] = sample[1];
+        sample[4] = (total_pages + swap_pages) * page_gb;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int samples = argc > 1 ? atoi(argv[1]) : 86400;
+    int cores = argc > 2 ? atoi(argv[2]) : 8;
+    if (samples < 1 || cores < 1) {
+        fprintf(stderr, "Usage: %s [samples] [cores]\n", argv[0]);
+        return 1;
+    }
+
+    int n_series = SERIES_FIXED_COUNT + cores;
+    int64_t *timestamps = malloc(samples * sizeof(int64_t));
+    double *values = malloc((size_t)samples * n_series * sizeof(double));
+    int64_t *decoded_timestamps = malloc(samples * sizeof(int64_t));
+    double *decoded_values = malloc((size_t)samples * n_series * sizeof(double));
+    if (!timestamps || !values || !decoded_timestamps || !decoded_values) {
+        perror("malloc");
+        return 1;
+    }
+    generate_trace(samples, cores, timestamps, values);
+
+    // Encode into a fresh file (recordings are appended to)
+    remove(BENCH_RECORDING);
+    double start = now_seconds();
+    SeriesWriter *writer = series_writer_open(BENCH_RECORDING, n_series);
+    for (int i = 0; i < samples; i++) {
+        series_writer_append(writer, timestamps[i], values + (size_t)i * n_series);
+    }
+    series_writer_close(writer);
+    double encode_time = now_seconds() - start;
+
+    FILE *fp = fopen(BENCH_RECORDING, "rb");
+    if (!fp) {
+        perror("fopen");
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    fclose(fp);
+
+    // Decode everything
+    start = now_seconds();
+    SeriesReader *reader = series_reader_open(BENCH_RECORDING);
+    if (!reader) {
+        perror("series_reader_open");
+        return 1;
+    }
+    const SeriesBlockHeader *header;
+    int decoded = 0, blocks = 0;
+    while ((header = series_reader_next_block(reader, NULL)) != NULL) {
+        if (decoded + (int)header->count > samples ||
+            series_reader_decode_block(reader, decoded_timestamps + decoded,
+                                       decoded_values + (size_t)decoded * n_series) != 0) {
+            fprintf(stderr, "Corrupt block %d\n", blocks);
+            return 1;
+        }
+        decoded += header->count;
+        blocks++;
+    }
+    series_reader_close(reader);
+    double decode_time = now_seconds() - start;
+
+    int exact = decoded == samples &&
+                memcmp(timestamps, decoded_timestamps, samples * sizeof(int64_t)) == 0 &&
+                memcmp(values, decoded_values, (size_t)samples * n_series * sizeof(double)) == 0;
+
+    // Range query: samples with total CPU >= 70%, skipping blocks by their min/max
+    start = now_seconds();
+    reader = series_reader_open(BENCH_RECORDING);
+    const SeriesRange *ranges;
+    int skipped = 0, matches = 0;
+    while ((header = series_reader_next_block(reader, &ranges)) != NULL) {
+        if (!series_block_may_contain(ranges, 0, 70.0, 100.0)) {
+            skipped++;
+            continue;
+        }
+        series_reader_decode_block(reader, decoded_timestamps, decoded_values);
+        for (uint32_t i = 0; i < header->count; i++) {
+            matches += decoded_values[(size_t)i * n_series] >= 70.0;
+        }
+    }
+    series_reader_close(reader);
+    double query_time = now_seconds() - start;
+    remove(BENCH_RECORDING);
+
+    size_t raw_bytes = (size_t)samples * (1 + n_series) * 8;
+    printf("samples: %d, series per sample: %d, blocks: %d\n", samples, n_series, blocks);
+    printf("size: %ld bytes (%.2f bytes/sample, %.2f bytes/value, %.1fx smaller than raw)\n",
+           file_size, (double)file_size / samples, (double)file_size / ((size_t)samples * n_series),
+           (double)raw_bytes / file_size);
+    printf("encode: %.2f Msamples/s (%.1f MB/s of raw doubles)\n", samples / encode_time / 1e6, raw_bytes / encode_time / 1e6);
+    printf("decode: %.2f Msamples/s (%.1f MB/s of raw doubles)\n", samples / decode_time / 1e6, raw_bytes / decode_time / 1e6);
+    printf("range query cpu >= 70%%: %d matches, %d of %d blocks skipped, %.2f ms\n", matches, skipped, blocks, query_time * 1e3);
+    printf("round trip: %s\n", exact ? "exact" : "MISMATCH");
+
+    free(timestamps);
+    free(values);
+    free(decoded_timestamps);
+    free(decoded_values);
+    return exact ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "shm_snapshot.h"
+
+// Benchmark for the shared-memory seqlock: one writer publishes samples at a fixed
+// rate while many readers hammer the segment. Every published field is derived from
+// the sample index, so a reader can tell a torn copy from a consistent one.
+//
+// Usage: bench/shm_bench [readers] [seconds] [writer_period_us]
+
+#define BENCH_SHM_NAME "/sys_stats_bench"
+
+// Shared state between the writer and reader threads
+typedef struct {
+    SharedSegment *segment;  // Segment under test
+    long writer_period_us;  // Delay between publications (0 = back to back)
+    volatile int stop;  // Set once the run is over
+    uint64_t published;  // Number of samples published by the writer
+} BenchState;
+
+// Per-reader results
+typedef struct {
+    BenchState *state;
+    uint64_t reads;  // Consistent snapshots obtained
+    uint64_t retries;  // Attempts that raced with the writer
+    uint64_t torn;  // Snapshots whose fields disagree (must stay 0)
+    uint64_t failed;  // Reads that gave up after SHM_SNAPSHOT_MAX_RETRIES (must stay 0)
+} ReaderResult;
+
+/**
+ * Returns a monotonic timestamp in nanoseconds.
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/**
+ * Fills a sample whose every field is a function of its index.
+ */
+static void make_sample(SharedSample *sample, uint64_t index) {
+    sample->timestamp_ns = index * 3;
+    sample->sample_index = index;
+    sample->flags = SHM_HAVE_CPU | SHM_HAVE_MEMORY | SHM_HAVE_SESSIONS;
+    sample->session_count = (int32_t)(index % 1000);
+    sample->cpu_usage = (double)(index % 100);
+    sample->memory.phys_used = (double)index;
+    sample->memory.phys_total = (double)index + 1;
+    sample->memory.virt_used = (double)index + 2;
+    sample->memory.virt_total = (double)index + 3;
+}
+
+/**
+ * Writer thread: publishes samples until told to stop.
+ */
+static void *writer_main(void *arg) {
+    BenchState *state = arg;
+    struct timespec period = {state->writer_period_us / 1000000, (state->writer_period_us % 1000000) * 1000};
+    SharedSample sample;
+    uint64_t index = 1;
+
+    while (!state->stop) {
+        make_sample(&sample, index++);
+        shm_snapshot_publish(state->segment, &sample);
+        // A failed sleep would turn the writer into a busy loop and skew the run
+        if (state->writer_period_us > 0 && nanosleep(&period, NULL) == -1 && errno != EINTR) {
+            perror("nanosleep");
+            exit(EXIT_FAILURE);
+        }
+    }
+    state->published = index - 1;
+    return NULL;
+}
+
+/**
+ * Reader thread: takes snapshots as fast as possible and checks each for tearing.
+ */
+static void *reader_main(void *arg) {
+    ReaderResult *result = arg;
+    const SharedSegment *segment = result->state->segment;
+    SharedSample sample, expected;
+
+    while (!result->state->stop) {
+        int retries = shm_snapshot_read(segment, &sample);
+        if (retries < 0) {
+            result->failed++;
+            continue;
+        }
+        result->retries += retries;
+        result->reads++;
+        make_sample(&expected, sample.sample_index);
+        if (memcmp(&sample, &expected, sizeof(sample)) != 0) {
+            result->torn++;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int readers = argc > 1 ? atoi(argv[1]) : 8;
+    int seconds = argc > 2 ? atoi(argv[2]) : 2;
+    BenchState state = {0};
+    state.writer_period_us = argc > 3 ? atol(argv[3]) : 100;
+
+    if (readers < 1 || seconds < 1 || state.writer_period_us < 0) {
+        fprintf(stderr, "Usage: %s [readers] [seconds] [writer_period_us]\n", argv[0]);
+        return 1;
+    }
+
+    state.segment = shm_snapshot_create(BENCH_SHM_NAME);
+    SharedSample first;
+    make_sample(&first, 0);
+    shm_snapshot_publish(state.segment, &first);
+
+    // Readers map the segment the same way an external agent would
+    const SharedSegment *reader_segment = shm_snapshot_open(BENCH_SHM_NAME);
+    if (!reader_segment) {
+        perror("shm_snapshot_open");
+        return 1;
+    }
+    BenchState reader_state = state;
+    reader_state.segment = (SharedSegment *)reader_segment;
+
+    pthread_t writer;
+    pthread_t *reader_threads = malloc(readers * sizeof(pthread_t));
+    ReaderResult *results = calloc(readers, sizeof(ReaderResult));
+    if (!reader_threads || !results) {
+        perror("malloc");
+        return 1;
+    }
+
+    uint64_t start = now_ns();
+    pthread_create(&writer, NULL, writer_main, &state);
+    for (int r = 0; r < readers; r++) {
+        results[r].state = &reader_state;
+        pthread_create(&reader_threads[r], NULL, reader_main, &results[r]);
+    }
+
+    sleep(seconds);
+    reader_state.stop = 1;
+    state.stop = 1;
+
+    uint64_t reads = 0, retries = 0, torn = 0, failed = 0;
+    for (int r = 0; r < readers; r++) {
+        pthread_join(reader_threads[r], NULL);
+        reads += results[r].reads;
+        retries += results[r].retries;
+        torn += results[r].torn;
+        failed += results[r].failed;
+    }
+    pthread_join(writer, NULL);
+    double elapsed = (now_ns() - start) / 1e9;
+
+    printf("readers: %d, duration: %.2f s, writer period: %ld us\n", readers, elapsed, state.writer_period_us);
+    printf("published: %lu (%.0f/s)\n", (unsigned long)state.published, state.published / elapsed);
+    printf("reads: %lu (%.0f/s total, %.1f ns/read per reader)\n", (unsigned long)reads, reads / elapsed,
+           reads ? elapsed * 1e9 * readers / reads : 0.0);
+    printf("retries: %lu (%.4f per read)\n", (unsigned long)retries, reads ? (double)retries / reads : 0.0);
+    printf("torn snapshots: %lu\n", (unsigned long)torn);
+    printf("failed reads: %lu\n", (unsigned long)failed);
+
+    shm_snapshot_close(reader_segment);
+    shm_snapshot_destroy(state.segment, BENCH_SHM_NAME);
+    free(reader_threads);
+    free(results);
+    return torn == 0 && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// Guard to prevent double inclusion of the header file
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+// Pluggable collectors.
+//
+// Every metric is a Collector: a set of callbacks registered in collector.c under a
+// command-line name. Each tick, the collectors whose output is needed sample
+// concurrently (one thread each) into preallocated slots of a Snapshot, which is
+// then rendered section by section and handed to the sinks (shared memory,
+// recording). Sections are rendered in parallel into separate buffers and stitched
+// in registry order. Slots are double-buffered, so the next tick can be sampled
+// while the current one is rendered. Adding a metric means writing a Collector and
+// adding it to the registry; the main loop does not change.
+
+#include <pthread.h>
+#include <stdint.h>
+#include "stats_functions.h"
+
+// Identifies a registered collector; also its index in the registry and in Snapshot.slots
+typedef enum {
+    COLLECTOR_MEMORY,
+    COLLECTOR_USERS,
+    COLLECTOR_CPU,
+    COLLECTOR_PROCESSES,
+    COLLECTOR_INTERRUPTS,
+    COLLECTOR_COUNT  // Number of registered collectors
+} CollectorId;
+
+// Bit of a collector in the masks passed to collector_set_init()
+#define COLLECTOR_BIT(id) (1u << (id))
+
+// Snapshots in flight: one being rendered while the next one is sampled
+#define SNAPSHOT_BUFFERS 2
+
+// Callbacks implementing one metric
+typedef struct {
+    const char *name;  // Name used with --collect
+    // Allocates the collector's state and sets *slot_size to the size of one sample slot
+    void *(*init)(const MonitorOptions *options, size_t *slot_size);
+    // Fills a slot; runs on its own thread, so it must not print or touch other collectors
+    void (*sample)(void *state, void *slot);
+    // Prints the section for a sampled slot to out. Runs on a render thread while the
+    // next tick is sampled, so it may only read the slot and state that sample never writes
+    void (*render)(FILE *out, void *state, const void *slot, int sample_index);
+    // Frees what a slot owns; NULL when slots own nothing
+    void (*release)(void *slot);
+    // Frees the state
+    void (*teardown)(void *state);
+} Collector;
+
+// One timestamped tick: a slot per collector, NULL for collectors that did not run
+typedef struct {
+    uint64_t timestamp_ns;  // CLOCK_REALTIME when sampling finished
+    int sample_index;  // Iteration number of the tick
+    void *slots[COLLECTOR_COUNT];
+} Snapshot;
+
+// The collectors in use and their state
+typedef struct {
+    unsigned needed;  // Collectors sampled every tick (displayed or used by a sink)
+    unsigned displayed;  // Collectors rendered every tick
+    void *states[COLLECTOR_COUNT];  // State returned by each collector's init
+    void *slots[SNAPSHOT_BUFFERS][COLLECTOR_COUNT];  // Preallocated slots of each needed collector, per buffer
+} CollectorSet;
+
+// Slot of the memory collector
+typedef struct {
+    MemoryStats stats;  // Used/total memory
+    VmstatRates paging;  // Paging, reclaim and swap activity since the previous sample
+} MemorySample;
+
+// Slot of the users collector
+typedef struct {
+    UserNode *head;  // Sessions, owned by the slot
+    int count;  // Number of sessions
+} UserSample;
+
+// Slot of the CPU collector
+typedef struct {
+    double usage;  // Total CPU usage in percent
+    int n_cores;  // Entries in core_usage (0 unless per-core usage was requested)
+    double core_usage[];  // Usage of each core in percent
+} CpuSample;
+
+// Looks up a collector by its --collect name; returns COLLECTOR_COUNT if unknown
+CollectorId find_collector(const char *name);
+
+// Returns the registered collector with the given id
+const Collector *get_collector(CollectorId id);
+
+// Works out from the options which collectors to sample and which to display
+void select_collectors(const MonitorOptions *options, unsigned *needed, unsigned *displayed);
+
+// Initializes the collectors in the needed mask; displayed must be a subset of needed
+void collector_set_init(CollectorSet *set, const MonitorOptions *options, unsigned needed, unsigned displayed);
+
+// Samples every needed collector concurrently into the buffer of the sample and fills the snapshot
+void collector_set_sample(CollectorSet *set, Snapshot *snapshot, int sample_index);
+
+// Renders the displayed collectors of a snapshot in parallel and prints them to out in registry order
+void collector_set_render(CollectorSet *set, const Snapshot *snapshot, FILE *out);
+
+// Tears down every initialized collector
+void collector_set_teardown(CollectorSet *set);
+
+// Starts a thread with SIGINT and SIGTSTP blocked; returns 0 or the pthread_create() error
+int collector_thread_create(pthread_t *thread, void *(*start)(void *), void *arg);
+
+// Built-in collectors, defined next to the functions they wrap
+extern const Collector memory_collector;
+extern const Collector users_collector;
+extern const Collector cpu_collector;
+extern const Collector processes_collector;
+extern const Collector interrupts_collector;
+
+// End of the include guard
+#endif
@@ -0,0 +1,494 @@
+#define _POSIX_C_SOURCE 200809L
+#include <ctype.h>
+#include <fcntl.h>  // For open()
+#include <time.h>  // For clock_gettime()
+#include "irq_stats.h"
+#include "collector.h"
+
+// Initial read buffer size; grown by doubling when a file does not fit
+#define IRQ_INITIAL_BUF_SIZE 16384
+
+/*
+ * Wrapper around realloc() that exits the program on failure, like the rest of the tool.
+ */
+static void *irq_realloc(void *ptr, size_t size) {
+    void *grown = realloc(ptr, size);
+    if (!grown && size > 0) {
+        perror("Failed to allocate interrupt table");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+/*
+ * Makes room for at least rows rows in every per-row array.
+ */
+static void reserve_rows(IrqTable *table, int rows) {
+    if (rows <= table->rows_capacity) {
+        return;
+    }
+    int capacity = table->rows_capacity ? table->rows_capacity * 2 : 64;
+    while (capacity < rows) {
+        capacity *= 2;
+    }
+    size_t cells = (size_t)capacity * table->n_cpus;
+    table->labels = irq_realloc(table->labels, capacity * sizeof(*table->labels));
+    table->descriptions = irq_realloc(table->descriptions, capacity * sizeof(*table->descriptions));
+    table->counts = irq_realloc(table->counts, cells * sizeof(uint32_t));
+    table->prev_counts = irq_realloc(table->prev_counts, cells * sizeof(uint32_t));
+    table->rates = irq_realloc(table->rates, cells * sizeof(double));
+    table->rows_capacity = capacity;
+}
+
+/*
+ * Parses the "CPU0 CPU1 ..." header line. Returns a pointer past the line and
+ * sets *changed when the set of CPU columns differs from the previous read.
+ */
+static const char *parse_header(IrqTable *table, const char *p, int *changed) {
+    int n_cpus = 0;
+
+    while (*p && *p != '\n') {
+        if (p[0] == 'C' && p[1] == 'P' && p[2] == 'U') {
+            int id = 0;
+            for (p += 3; isdigit((unsigned char)*p); p++) {
+                id = id * 10 + (*p - '0');
+            }
+            if (n_cpus == table->header_capacity) {
+                table->header_capacity = table->header_capacity ? table->header_capacity * 2 : 64;
+                table->header_ids = irq_realloc(table->header_ids, table->header_capacity * sizeof(int));
+            }
+            table->header_ids[n_cpus++] = id;
+        } else {
+            p++;
+        }
+    }
+
+    if (n_cpus != table->n_cpus || memcmp(table->header_ids, table->cpu_ids, n_cpus * sizeof(int)) != 0) {
+        // CPU hotplug (or first read): reshape every per-CPU array
+        table->n_cpus = n_cpus;
+        table->cpu_ids = irq_realloc(table->cpu_ids, n_cpus * sizeof(int));
+        memcpy(table->cpu_ids, table->header_ids, n_cpus * sizeof(int));
+        table->cpu_rates = irq_realloc(table->cpu_rates, n_cpus * sizeof(double));
+        int capacity = table->rows_capacity;
+        table->rows_capacity = 0;
+        reserve_rows(table, capacity ? capacity : 1);
+        *changed = 1;
+    }
+    return *p ? p + 1 : p;
+}
+
+/*
+ * Parses the whole table in one pass into table->counts. Sets *changed when the
+ * rows differ from the previous read, in which case no rates can be computed.
+ */
+static void parse_table(IrqTable *table, int *changed) {
+    const char *p = parse_header(table, table->buf, changed);
+    int row = 0;
+
+    while (*p) {
+        // Label: up to the colon
+        while (*p == ' ') {
+            p++;
+        }
+        const char *label = p;
+        while (*p && *p != ':' && *p != '\n') {
+            p++;
+        }
+        if (*p != ':') {
+            p += (*p == '\n');
+            continue; // Not a counter line
+        }
+        size_t label_len = MIN((size_t)(p - label), (size_t)IRQ_LABEL_LEN - 1);
+        p++;
+
+        reserve_rows(table, row + 1);
+        if (row >= table->n_rows || strncmp(table->labels[row], label, label_len) != 0 ||
+            table->labels[row][label_len] != '\0') {
+            memcpy(table->labels[row], label, label_len);
+            table->labels[row][label_len] = '\0';
+            *changed = 1;
+        }
+
+        // One counter per CPU; some rows (ERR, MIS) only have a single total
+        uint32_t *counts = table->counts + (size_t)row * table->n_cpus;
+        int col = 0;
+        for (; col < table->n_cpus; col++) {
+            while (*p == ' ') {
+                p++;
+            }
+            if (!isdigit((unsigned char)*p)) {
+                break;
+            }
+            uint32_t value = 0;
+            for (; isdigit((unsigned char)*p); p++) {
+                value = value * 10 + (*p - '0');
+            }
+            counts[col] = value;
+        }
+        for (; col < table->n_cpus; col++) {
+            counts[col] = 0;
+        }
+
+        // Description: the rest of the line with runs of spaces collapsed
+        char *desc = table->descriptions[row];
+        size_t len = 0;
+        while (*p == ' ') {
+            p++;
+        }
+        for (; *p && *p != '\n'; p++) {
+            if (len < IRQ_DESC_LEN - 1 && !(*p == ' ' && len > 0 && desc[len - 1] == ' ')) {
+                desc[len++] = *p;
+            }
+        }
+        desc[len] = '\0';
+        p += (*p == '\n');
+        row++;
+    }
+
+    if (row != table->n_rows) {
+        *changed = 1;
+    }
+    table->n_rows = row;
+}
+
+/*
+ * Turns counter deltas into per-second rates. The loop is branch-free over a dense
+ * array with non-aliasing pointers so the compiler can vectorize it; the unsigned
+ * 32-bit subtraction also absorbs counter wraparound.
+ */
+static void compute_rates(const uint32_t *restrict counts, const uint32_t *restrict prev_counts,
+                          double *restrict rates, size_t cells, double per_second) {
+    for (size_t k = 0; k < cells; k++) {
+        rates[k] = (uint32_t)(counts[k] - prev_counts[k]) * per_second;
+    }
+}
+
+/**
+ * Opens a /proc interrupt table and keeps the descriptor for later samples.
+ * The first read is taken immediately as the baseline for the first rates.
+ *
+ * @param path Path of the table, "/proc/interrupts" or "/proc/softirqs".
+ * @param title Section title used when printing.
+ * @return The table.
+ */
+IrqTable *irq_table_open(const char *path, const char *title) {
+    IrqTable *table = calloc(1, sizeof(IrqTable));
+    if (!table) {
+        perror("Failed to allocate interrupt table");
+        exit(EXIT_FAILURE);
+    }
+    table->title = title;
+    table->fd = open(path, O_RDONLY);
+    if (table->fd == -1) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    table->buf_size = IRQ_INITIAL_BUF_SIZE;
+    table->buf = irq_realloc(NULL, table->buf_size);
+
+    irq_table_sample(table);
+    return table;
+}
+
+/**
+ * Re-reads the table through the persistent descriptor and computes per-second
+ * rates against the previous read. When CPUs or IRQ rows appear or disappear
+ * between reads, this sample only becomes the new baseline.
+ *
+ * @param table Table returned by irq_table_open().
+ * @return 1 if the table now holds valid rates, 0 otherwise.
+ */
+int irq_table_sample(IrqTable *table) {
+    struct timespec now;
+    int changed = 0;
+
+    if (pread_whole_file(table->fd, &table->buf, &table->buf_size) < 0) {
+        perror("Failed to read interrupt table");
+        exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    parse_table(table, &changed);
+
+    double now_seconds = now.tv_sec + now.tv_nsec / 1e9;
+    double elapsed = now_seconds - table->last_read;
+    size_t cells = (size_t)table->n_rows * table->n_cpus;
+    table->have_rates = !changed && elapsed > 0;
+    if (table->have_rates) {
+        compute_rates(table->counts, table->prev_counts, table->rates, cells, 1.0 / elapsed);
+        for (int col = 0; col < table->n_cpus; col++) {
+            table->cpu_rates[col] = 0.0;
+        }
+        for (int row = 0; row < table->n_rows; row++) {
+            const double *rates = table->rates + (size_t)row * table->n_cpus;
+            for (int col = 0; col < table->n_cpus; col++) {
+                table->cpu_rates[col] += rates[col];
+            }
+        }
+    }
+
+    // The counters just read become the baseline of the next sample
+    uint32_t *swap = table->prev_counts;
+    table->prev_counts = table->counts;
+    table->counts = swap;
+    table->last_read = now_seconds;
+    return table->have_rates;
+}
+
+/*
+ * Returns the sum of the rates of one row.
+ */
+static double row_total(const IrqTable *table, int row) {
+    double total = 0.0;
+    const double *rates = table->rates + (size_t)row * table->n_cpus;
+    for (int col = 0; col < table->n_cpus; col++) {
+        total += rates[col];
+    }
+    return total;
+}
+
+/*
+ * Picks up to max indices with the largest keys (> 0), in descending key order.
+ * Returns how many were picked.
+ */
+static int pick_largest(const double *keys, int n, int *picked, int max) {
+    int count = 0;
+    while (count < max) {
+        int best = -1;
+        for (int k = 0; k < n; k++) {
+            int taken = 0;
+            for (int j = 0; j < count; j++) {
+                taken |= picked[j] == k;
+            }
+            if (!taken && keys[k] > 0 && (best < 0 || keys[k] > keys[best])) {
+                best = k;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        picked[count++] = best;
+    }
+    return count;
+}
+
+/*
+ * Comparison function for sorting column indices in ascending order.
+ */
+static int compare_ints(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+/**
+ * Extracts what is displayed of the table's latest sample: the busiest rows, the
+ * CPU columns (every CPU, or the IRQ_MAX_COLUMNS busiest ones in CPU order) and the
+ * hot cores, those taking more than IRQ_HOT_FACTOR times the mean rate.
+ *
+ * @param table Table sampled with irq_table_sample().
+ * @param view Receives the extract.
+ */
+void irq_table_view(const IrqTable *table, IrqView *view) {
+    view->title = table->title;
+    view->have_rates = table->have_rates;
+    view->n_cpus = table->n_cpus;
+    if (!table->have_rates) {
+        return;
+    }
+
+    // Columns: every CPU, or the busiest ones in CPU order
+    int columns[IRQ_MAX_COLUMNS];
+    if (table->n_cpus <= IRQ_MAX_COLUMNS) {
+        for (view->n_columns = 0; view->n_columns < table->n_cpus; view->n_columns++) {
+            columns[view->n_columns] = view->n_columns;
+        }
+    } else {
+        view->n_columns = pick_largest(table->cpu_rates, table->n_cpus, columns, IRQ_MAX_COLUMNS);
+        qsort(columns, view->n_columns, sizeof(int), compare_ints);
+    }
+    for (int c = 0; c < view->n_columns; c++) {
+        view->column_ids[c] = table->cpu_ids[columns[c]];
+        view->column_rates[c] = table->cpu_rates[columns[c]];
+    }
+
+    view->total = 0.0;
+    for (int col = 0; col < table->n_cpus; col++) {
+        view->total += table->cpu_rates[col];
+    }
+    view->hot_threshold = table->n_cpus > 1 ? IRQ_HOT_FACTOR * view->total / table->n_cpus : INFINITY;
+
+    // Busiest rows
+    double totals[table->n_rows > 0 ? table->n_rows : 1];
+    int rows[IRQ_MAX_ROWS];
+    for (int row = 0; row < table->n_rows; row++) {
+        totals[row] = row_total(table, row);
+    }
+    view->n_rows = pick_largest(totals, table->n_rows, rows, IRQ_MAX_ROWS);
+    for (int r = 0; r < view->n_rows; r++) {
+        const double *rates = table->rates + (size_t)rows[r] * table->n_cpus;
+        memcpy(view->labels[r], table->labels[rows[r]], IRQ_LABEL_LEN);
+        memcpy(view->descriptions[r], table->descriptions[rows[r]], IRQ_DESC_LEN);
+        for (int c = 0; c < view->n_columns; c++) {
+            view->rates[r][c] = rates[columns[c]];
+        }
+        view->row_totals[r] = totals[rows[r]];
+    }
+
+    // Hot cores
+    view->n_hot = 0;
+    for (int col = 0; col < table->n_cpus; col++) {
+        if (table->cpu_rates[col] > view->hot_threshold) {
+            if (view->n_hot < IRQ_MAX_COLUMNS) {
+                view->hot_ids[view->n_hot] = table->cpu_ids[col];
+                view->hot_shares[view->n_hot] = 100.0 * table->cpu_rates[col] / view->total;
+            }
+            view->n_hot++;
+        }
+    }
+}
+
+/**
+ * Prints a view as a matrix of per-CPU rates of the busiest rows, followed by the
+ * total rate of every shown CPU. Hot cores are marked with '*' and listed at the end.
+ *
+ * @param out Stream to print to.
+ * @param view View extracted with irq_table_view().
+ */
+void print_irq_view(FILE *out, const IrqView *view) {
+    fprintf(out, "### %s ### (per second, * = hot core)\n", view->title);
+    if (!view->have_rates) {
+        fprintf(out, " (collecting baseline)\n");
+        return;
+    }
+    if (view->n_columns < view->n_cpus) {
+        fprintf(out, " (busiest %d of %d CPUs)\n", view->n_columns, view->n_cpus);
+    }
+
+    // Header row
+    fprintf(out, " %-8s", "IRQ");
+    for (int c = 0; c < view->n_columns; c++) {
+        char name[16];
+        snprintf(name, sizeof(name), "CPU%d", view->column_ids[c]);
+        fprintf(out, " %8s ", name);
+    }
+    fprintf(out, " %10s\n", "total");
+
+    // Busiest rows
+    for (int r = 0; r < view->n_rows; r++) {
+        fprintf(out, " %-8s", view->labels[r]);
+        for (int c = 0; c < view->n_columns; c++) {
+            fprintf(out, " %8.0f ", view->rates[r][c]);
+        }
+        fprintf(out, " %10.0f  %s\n", view->row_totals[r], view->descriptions[r]);
+    }
+
+    // Per-CPU totals with hot cores marked
+    fprintf(out, " %-8s", "all");
+    for (int c = 0; c < view->n_columns; c++) {
+        double rate = view->column_rates[c];
+        fprintf(out, " %8.0f%c", rate, rate > view->hot_threshold ? '*' : ' ');
+    }
+    fprintf(out, " %10.0f\n", view->total);
+
+    fprintf(out, " hot cores:");
+    for (int k = 0; k < MIN(view->n_hot, IRQ_MAX_COLUMNS); k++) {
+        fprintf(out, " CPU%d (%.1f%%)", view->hot_ids[k], view->hot_shares[k]);
+    }
+    if (view->n_hot > IRQ_MAX_COLUMNS) {
+        fprintf(out, " (+%d more)", view->n_hot - IRQ_MAX_COLUMNS);
+    }
+    fprintf(out, "%s\n", view->n_hot ? "" : " none");
+}
+
+/**
+ * Closes the table's descriptor and frees its buffers.
+ *
+ * @param table Table returned by irq_table_open(); freed by this call.
+ */
+void irq_table_close(IrqTable *table) {
+    close(table->fd);
+    free(table->buf);
+    free(table->cpu_ids);
+    free(table->header_ids);
+    free(table->labels);
+    free(table->descriptions);
+    free(table->counts);
+    free(table->prev_counts);
+    free(table->rates);
+    free(table->cpu_rates);
+    free(table);
+}
+
+// interrupts collector
+
+// State of the interrupts collector: both tables
+typedef struct {
+    IrqTable *hard;  // /proc/interrupts
+    IrqTable *soft;  // /proc/softirqs
+} IrqCollectorState;
+
+/**
+ * Opens both interrupt tables, taking the baseline of the first sample.
+ *
+ * @param options Program options (unused).
+ * @param slot_size Receives the size of a slot (one IrqSample).
+ * @return The collector state.
+ */
+static void *interrupts_collector_init(const MonitorOptions *options, size_t *slot_size) {
+    (void)options;
+    IrqCollectorState *state = malloc(sizeof(IrqCollectorState));
+    if (!state) {
+        perror("Failed to allocate interrupts collector");
+        exit(EXIT_FAILURE);
+    }
+    state->hard = irq_table_open("/proc/interrupts", "Interrupts");
+    state->soft = irq_table_open("/proc/softirqs", "Softirqs");
+    *slot_size = sizeof(IrqSample);
+    return state;
+}
+
+/**
+ * Samples both tables and extracts what is displayed of them into the slot.
+ *
+ * @param state Collector state.
+ * @param slot IrqSample to fill.
+ */
+static void interrupts_collector_sample(void *state, void *slot) {
+    IrqCollectorState *irq = state;
+    IrqSample *sample = slot;
+    irq_table_sample(irq->hard);
+    irq_table_sample(irq->soft);
+    irq_table_view(irq->hard, &sample->hard);
+    irq_table_view(irq->soft, &sample->soft);
+}
+
+/**
+ * Prints both tables.
+ *
+ * @param out Stream to print to.
+ * @param state Collector state (unused).
+ * @param slot Sampled IrqSample.
+ * @param sample_index Index of the current sample (unused).
+ */
+static void interrupts_collector_render(FILE *out, void *state, const void *slot, int sample_index) {
+    (void)state;
+    (void)sample_index;
+    const IrqSample *sample = slot;
+    print_irq_view(out, &sample->hard);
+    print_irq_view(out, &sample->soft);
+}
+
+/**
+ * Closes both tables.
+ *
+ * @param state Collector state.
+ */
+static void interrupts_collector_teardown(void *state) {
+    IrqCollectorState *irq = state;
+    irq_table_close(irq->hard);
+    irq_table_close(irq->soft);
+    free(irq);
+}
+
+const Collector interrupts_collector = {
+    "interrupts", interrupts_collector_init, interrupts_collector_sample,
+    interrupts_collector_render, NULL, interrupts_collector_teardown
+};
@@ -0,0 +1,94 @@
+// Guard to prevent double inclusion of the header file
+#ifndef IRQ_STATS_H
+#define IRQ_STATS_H
+
+// Per-IRQ, per-CPU interrupt rates from /proc/interrupts and /proc/softirqs.
+//
+// Both files share one layout: a header line naming the CPU columns, then one line
+// per interrupt source with a label, one counter per CPU and an optional description.
+// Each file is kept open and re-read with pread() into a reusable buffer, parsed in a
+// single pass into a dense rows x CPUs counter array, and differenced against the
+// previous sample to get rates.
+
+#include <stdint.h>
+#include "stats_functions.h"
+
+// Longest IRQ label ("NMI", "24", "NET_RX") and description kept per row
+#define IRQ_LABEL_LEN 16
+#define IRQ_DESC_LEN 40
+
+// Most CPU columns printed; wider machines show their busiest CPUs
+#define IRQ_MAX_COLUMNS 16
+
+// Most IRQ rows printed per table, busiest first
+#define IRQ_MAX_ROWS 10
+
+// A core is hot when it takes more than this multiple of the mean per-CPU rate
+#define IRQ_HOT_FACTOR 2.0
+
+// Counters and rates of one /proc interrupt table
+typedef struct {
+    const char *title;  // Section title, e.g. "Interrupts"
+    int fd;  // Persistent descriptor on the /proc file
+    char *buf;  // Read buffer, grown to fit the whole file
+    size_t buf_size;  // Capacity of buf
+    int n_cpus;  // Number of CPU columns
+    int *cpu_ids;  // CPU number of each column
+    int *header_ids;  // CPU numbers parsed from the latest header line, compared with cpu_ids
+    int header_capacity;  // Allocated entries in header_ids
+    int n_rows;  // Number of interrupt sources
+    int rows_capacity;  // Allocated rows in the arrays below
+    char (*labels)[IRQ_LABEL_LEN];  // Label of each row
+    char (*descriptions)[IRQ_DESC_LEN];  // Description of each row (may be empty)
+    uint32_t *counts;  // Buffer the next read is parsed into, n_rows x n_cpus (the kernel's counters are 32-bit)
+    uint32_t *prev_counts;  // Counters of the latest read, the baseline of the next sample
+    double *rates;  // Per-second rates, n_rows x n_cpus
+    double *cpu_rates;  // Sum of the rates of each CPU column
+    int have_rates;  // Whether rates hold a valid interval
+    double last_read;  // CLOCK_MONOTONIC time in seconds when counts were read
+} IrqTable;
+
+// Display-ready extract of one sample of a table: its busiest rows and CPUs.
+// It is copied out of the IrqTable so it can be printed while the table is re-sampled.
+typedef struct {
+    const char *title;  // Section title
+    int have_rates;  // Whether the sample held valid rates
+    int n_cpus;  // CPUs in the table
+    int n_columns;  // CPU columns shown
+    int column_ids[IRQ_MAX_COLUMNS];  // CPU number of each shown column
+    double column_rates[IRQ_MAX_COLUMNS];  // Total rate of each shown column
+    int n_rows;  // Rows shown
+    char labels[IRQ_MAX_ROWS][IRQ_LABEL_LEN];  // Label of each shown row
+    char descriptions[IRQ_MAX_ROWS][IRQ_DESC_LEN];  // Description of each shown row
+    double rates[IRQ_MAX_ROWS][IRQ_MAX_COLUMNS];  // Rate of each shown cell
+    double row_totals[IRQ_MAX_ROWS];  // Total rate of each shown row over all CPUs
+    double total;  // Total rate over all rows and CPUs
+    double hot_threshold;  // Rate above which a CPU is hot
+    int n_hot;  // Number of hot CPUs, listed or not
+    int hot_ids[IRQ_MAX_COLUMNS];  // CPU number of the first hot CPUs
+    double hot_shares[IRQ_MAX_COLUMNS];  // Share of the total rate taken by each listed hot CPU, in percent
+} IrqView;
+
+// Slot of the interrupts collector
+typedef struct {
+    IrqView hard;  // /proc/interrupts
+    IrqView soft;  // /proc/softirqs
+} IrqSample;
+
+// Opens a /proc interrupt table and takes the baseline sample
+IrqTable *irq_table_open(const char *path, const char *title);
+
+// Re-reads the table and computes rates since the previous sample
+int irq_table_sample(IrqTable *table);
+
+// Extracts the busiest rows and CPUs of the latest sample and the hot cores
+void irq_table_view(const IrqTable *table, IrqView *view);
+
+// Prints a view as a matrix of per-CPU rates and highlights hot cores
+void print_irq_view(FILE *out, const IrqView *view);
+
+// Closes the table and frees its buffers
+void irq_table_close(IrqTable *table);
+
+// End of the include guard
+#endif
@@ -1,7 +1,23 @@
+#define _POSIX_C_SOURCE 200809L
+#include <limits.h>  // For INT_MAX
+#include <poll.h>  // For waiting on the quit pipe
+#include <pthread.h>
+#include <time.h>  // For clock_gettime()
 #include "stats_functions.h"
+#include "shm_snapshot.h"
+#include "series_store.h"
+#include "collector.h"
+
+// Set by the SIGINT handler once the user confirms; the main loop then stops and
+// goes through the normal cleanup, so the sinks are closed
+static volatile sig_atomic_t quit_requested = 0;
+
+// Written to by the SIGINT handler on confirmation, to wake a thread waiting for the next tick
+static int quit_pipe[2] = {-1, -1};
 
 /**
  * Handles the SIGINT signal by prompting the user to confirm if they want to exit the program.
+ * On confirmation it only requests the exit; the main loop finishes the current tick first.
  * @param sig_num The signal number (expected to be SIGINT).
  */
 void sigint_handler(int sig_num) {
@@ -9,12 +25,14 @@ void sigint_handler(int sig_num) {
     signal(SIGINT, SIG_IGN);
 
     printf("\nDo you want to quit? [y/N]: ");
-    char response[10];
+    char response[10] = "";
     fgets(response, sizeof(response), stdin);
 
     if (response[0] == 'y' || response[0] == 'Y') {
         printf("Exiting program...\n");
-        exit(0); // Exit the program if the user confirms
+        // Leave SIGINT ignored while the program shuts down
+        quit_requested = 1;
+        write(quit_pipe[1], "q", 1); // Wakes wait_for_tick(); the only write, so the pipe has room
     } else {
         printf("Continuing execution...\n");
         // Re-enable the SIGINT handler for future signals
@@ -22,6 +40,167 @@ void sigint_handler(int sig_num) {
     }
 }
 
+/**
+ * Publishes a snapshot to the shared memory segment, flagging the fields whose
+ * collectors ran this tick.
+ *
+ * @param segment Segment returned by shm_snapshot_create().
+ * @param snapshot Snapshot of the current tick.
+ */
+static void publish_snapshot(SharedSegment *segment, const Snapshot *snapshot) {
+    SharedSample shared_sample = {0};
+    const MemorySample *memory = snapshot->slots[COLLECTOR_MEMORY];
+    const UserSample *users = snapshot->slots[COLLECTOR_USERS];
+    const CpuSample *cpu = snapshot->slots[COLLECTOR_CPU];
+
+    shared_sample.timestamp_ns = snapshot->timestamp_ns;
+    shared_sample.sample_index = snapshot->sample_index;
+    if (memory) {
+        shared_sample.memory.phys_used = memory->stats.phys_used;
+        shared_sample.memory.phys_total = memory->stats.phys_total;
+        shared_sample.memory.virt_used = memory->stats.virt_used;
+        shared_sample.memory.virt_total = memory->stats.virt_total;
+        shared_sample.flags |= SHM_HAVE_MEMORY;
+    }
+    if (users) {
+        shared_sample.session_count = users->count;
+        shared_sample.flags |= SHM_HAVE_SESSIONS;
+    }
+    if (cpu) {
+        shared_sample.cpu_usage = cpu->usage;
+        shared_sample.flags |= SHM_HAVE_CPU;
+    }
+    shm_snapshot_publish(segment, &shared_sample);
+}
+
+/**
+ * Appends a snapshot to the recording: total CPU, the MemoryStats fields, then one
+ * value per core. Series whose collector did not run are stored as NaN.
+ *
+ * @param recorder Encoder returned by series_writer_open().
+ * @param snapshot Snapshot of the current tick.
+ * @param values Scratch array of SERIES_FIXED_COUNT + n_cores values.
+ * @param n_cores Number of per-core series in the recording.
+ */
+static void record_snapshot(SeriesWriter *recorder, const Snapshot *snapshot, double *values, int n_cores) {
+    const MemorySample *memory = snapshot->slots[COLLECTOR_MEMORY];
+    const CpuSample *cpu = snapshot->slots[COLLECTOR_CPU];
+
+    // CPU values are rounded to the 0.01% that is displayed, which also keeps the XORs short
+    values[0] = cpu ? round(cpu->usage * 100.0) / 100.0 : NAN;
+    values[1] = memory ? memory->stats.phys_used : NAN;
+    values[2] = memory ? memory->stats.phys_total : NAN;
+    values[3] = memory ? memory->stats.virt_used : NAN;
+    values[4] = memory ? memory->stats.virt_total : NAN;
+    for (int core = 0; core < n_cores; core++) {
+        values[SERIES_FIXED_COUNT + core] = cpu && core < cpu->n_cores ? round(cpu->core_usage[core] * 100.0) / 100.0 : NAN;
+    }
+    series_writer_append(recorder, snapshot->timestamp_ns / 1000000, values);
+}
+
+/*
+ * Waits tdelay seconds before the next tick, or less if the user confirms quitting
+ * meanwhile. Returns 1 when the delay has elapsed, 0 if the program should quit.
+ */
+static int wait_for_tick(double tdelay) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double deadline = now.tv_sec + now.tv_nsec / 1e9 + tdelay;
+    struct pollfd quit_fd = {quit_pipe[0], POLLIN, 0};
+
+    while (!quit_requested) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double remaining = deadline - (now.tv_sec + now.tv_nsec / 1e9);
+        if (remaining <= 0) {
+            return 1;
+        }
+        // poll() takes milliseconds: round up so the delay is never cut short.
+        // EINTR (the Ctrl-C prompt ran on this thread) just goes round the loop again.
+        poll(&quit_fd, 1, remaining < INT_MAX / 1000 ? (int)ceil(remaining * 1000) : INT_MAX);
+    }
+    return 0;
+}
+
+// Where each collected tick is handed, besides the display
+typedef struct {
+    SharedSegment *segment;  // --shm segment, or NULL
+    SeriesWriter *recorder;  // --record encoder, or NULL
+    double *series_values;  // Scratch array for record_snapshot()
+    int n_cores;  // Number of per-core series in the recording
+} Sinks;
+
+// Arguments of the thread collecting the next tick
+typedef struct {
+    CollectorSet *collectors;
+    Snapshot *snapshot;  // Snapshot to fill
+    int sample_index;  // Index of the tick
+    double tdelay;  // Delay before sampling, in seconds
+    Sinks *sinks;  // Sinks the tick is handed to once sampled
+} CollectJob;
+
+/*
+ * Waits for the tick's delay, samples every collector into its snapshot, then hands
+ * the snapshot to the sinks. The snapshot is left unsampled if the user quits during the wait.
+ * Also the entry point of the thread that collects a tick while the previous one is
+ * rendered, so the sinks get each tick as soon as it is sampled, without waiting for
+ * the previous frame to be written out. Only one job runs at a time, so the sinks
+ * are never used from two threads at once.
+ */
+static void *run_collect_job(void *arg) {
+    CollectJob *job = arg;
+    if (wait_for_tick(job->tdelay)) {
+        collector_set_sample(job->collectors, job->snapshot, job->sample_index);
+        if (job->sinks->segment) {
+            publish_snapshot(job->sinks->segment, job->snapshot);
+        }
+        if (job->sinks->recorder) {
+            record_snapshot(job->sinks->recorder, job->snapshot, job->sinks->series_values, job->sinks->n_cores);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Starts collecting a tick on its own thread, with SIGINT and SIGTSTP blocked like
+ * every helper thread. Returns 1 if the thread was started, 0 if the caller must run the job itself.
+ */
+static int start_collect_job(pthread_t *thread, CollectJob *job) {
+    return collector_thread_create(thread, run_collect_job, job) == 0;
+}
+
+/**
+ * Formats the header and every displayed section of a snapshot into one frame, then
+ * writes the frame to standard output with a single write(), so a refreshing
+ * display is never seen half drawn.
+ *
+ * @param options Program options.
+ * @param collectors Initialized collector set.
+ * @param snapshot Snapshot to display.
+ */
+static void display_frame(const MonitorOptions *options, CollectorSet *collectors, const Snapshot *snapshot) {
+    char *frame;
+    size_t length;
+    FILE *out = open_memstream(&frame, &length);
+    if (!out) {
+        perror("Failed to allocate frame");
+        exit(EXIT_FAILURE);
+    }
+    display_header(out, snapshot->sample_index, options->samples, options->tdelay, options->sequential_flag, options->system_flag);
+    collector_set_render(collectors, snapshot, out);
+    fclose(out);
+
+    fflush(stdout); // Keep anything printed with stdio before the frame
+    for (size_t written = 0; written < length;) {
+        ssize_t n = write(STDOUT_FILENO, frame + written, length - written);
+        if (n < 0) {
+            perror("Failed to write frame");
+            exit(EXIT_FAILURE);
+        }
+        written += n;
+    }
+    free(frame);
+}
+
 /**
  * The main entry point of the program. Initializes the application, sets up signal handling,
  * and manages the execution flow based on user input and signal events.
@@ -30,68 +209,85 @@ int main(int argc, char *argv[]) {
     // Ignore Ctrl-Z signals (SIGTSTP)
     signal(SIGTSTP, SIG_IGN);
 
+    // Create the pipe the Ctrl-C handler wakes the collection with
+    if (pipe(quit_pipe) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
     // Handle Ctrl-C (SIGINT) using the sigint_handler function
     signal(SIGINT, sigint_handler);
 
-    // Initialize variables based on user input or default values
-    int samples = 10, tdelay = 1;
-    int system_flag = 0, user_flag = 0, graphics_flag = 0, sequential_flag = 0;
-    double prev_virt = 0.00; // Used for graphical memory usage display
+    // Initialize options with default values, then apply the command line
+    MonitorOptions options = {0};
+    options.samples = 10;
+    options.tdelay = 1;
+    parse_arguments(argc, argv, &options);
 
-    // Parse command-line arguments to configure the program's execution
-    parse_arguments(argc, argv, &samples, &tdelay, &system_flag, &user_flag, &graphics_flag, &sequential_flag);
+    // Set up the collectors that are displayed or feed a sink
+    unsigned needed, displayed;
+    CollectorSet collectors;
+    Snapshot snapshots[SNAPSHOT_BUFFERS];
+    select_collectors(&options, &needed, &displayed);
+    collector_set_init(&collectors, &options, needed, displayed);
 
-    // Allocate memory for storing statistics and graphical representations
-    MemoryStats memory_stats_array[samples];
-    char cpu_graphics_arr[samples][1024];
+    // Create the shared memory segment other processes read the latest sample from
+    SharedSegment *shm_segment = options.shm_name ? shm_snapshot_create(options.shm_name) : NULL;
 
-    // Pipe file descriptors for inter-process communication
-    int mem_pipefd[2], cpu_pipefd[2], user_pipefd[2];
+    // Open the recording: total CPU, the MemoryStats fields, then one series per core
+    int n_cores = sysconf(_SC_NPROCESSORS_CONF);
+    SeriesWriter *recorder = options.record_path ? series_writer_open(options.record_path, SERIES_FIXED_COUNT + n_cores) : NULL;
+    double series_values[SERIES_FIXED_COUNT + n_cores];
+    Sinks sinks = {shm_segment, recorder, series_values, n_cores};
+
+    // Collect the first tick, sampling every collector concurrently into one snapshot
+    CollectJob job = {&collectors, &snapshots[0], 0, options.tdelay, &sinks};
+    if (options.samples > 0) {
+        run_collect_job(&job);
+    }
 
-    // Main loop to collect and display system statistics for the number of specified samples
-    for (int i = 0; i < samples; ++i) {
-        // Create pipes for memory, CPU, and user statistics
-        if (pipe(mem_pipefd) == -1 || pipe(cpu_pipefd) == -1 || pipe(user_pipefd) == -1) {
-            fprintf(stderr, "Pipe creation failed\n");
-            return 1; // Exit if pipe creation fails
+    // Main loop to collect and display system statistics for the number of specified samples.
+    // Tick i + 1 is collected on its own thread into the other snapshot while tick i is
+    // displayed, so a tick takes the longer of the two stages rather than their sum.
+    // A confirmed Ctrl-C ends the loop; a tick collected after it is never displayed.
+    for (int i = 0; i < options.samples && !quit_requested; ++i) {
+        const Snapshot *snapshot = &snapshots[i % SNAPSHOT_BUFFERS];
+        pthread_t collect_thread;
+        int collecting = 0;
+        if (i + 1 < options.samples) {
+            job = (CollectJob){&collectors, &snapshots[(i + 1) % SNAPSHOT_BUFFERS], i + 1, options.tdelay, &sinks};
+            collecting = start_collect_job(&collect_thread, &job);
         }
 
-        // Collect initial CPU usage data
-        unsigned long idle_start, total_start;
-        get_cpu_idle_total_times(&idle_start, &total_start);
-        sleep(tdelay); // Wait for the specified delay time
-
-        // Display header information for the current sample
-        display_header(i, samples, tdelay, sequential_flag, system_flag);
-
-        // Process and display memory, user, and CPU statistics
-        if (!user_flag || (user_flag && system_flag)) {
-            printf("---------------------------------------\n");
-            launchMemoryStatsProcess(mem_pipefd, memory_stats_array, samples, i, sequential_flag, graphics_flag, &prev_virt);
-            if ((user_flag && system_flag) || !system_flag) {
-                printf("---------------------------------------\n");
-                UserNode* userHead = launchUserStatsProcess(user_pipefd);
-                print_user_list(userHead);
-                free_user_list(userHead); // Clean up the user list
-                printf("---------------------------------------\n");
-            }
-            get_cpu_cores();
-            launchCpuStatsProcess(cpu_pipefd, idle_start, total_start, graphics_flag, i, cpu_graphics_arr, samples, sequential_flag);
-        } else {
-            printf("---------------------------------------\n");
-            UserNode* userHead = launchUserStatsProcess(user_pipefd);
-            print_user_list(userHead);
-            free_user_list(userHead); // Clean up the user list
-            printf("---------------------------------------\n");
+        // Display header information and every section for the current sample; the
+        // sinks already got it when it was collected
+        display_frame(&options, &collectors, snapshot);
+
+        // Wait for the next tick (or collect it now if no thread could be started)
+        if (collecting) {
+            pthread_join(collect_thread, NULL);
+        } else if (i + 1 < options.samples) {
+            run_collect_job(&job);
         }
     }
 
+    // Remove the shared memory segment now that no more samples will be published
+    if (shm_segment) {
+        shm_snapshot_destroy(shm_segment, options.shm_name);
+    }
+
+    // Write out the last block of the recording
+    if (recorder) {
+        series_writer_close(recorder);
+    }
+
+    collector_set_teardown(&collectors);
+    close(quit_pipe[0]);
+    close(quit_pipe[1]);
+
     // Display final system information after processing all samples
     printf("---------------------------------------\n");
     print_system_info();
     printf("---------------------------------------\n");
     return 0; // End of program
 }
-
-
-
@@ -0,0 +1,428 @@
+#define _DEFAULT_SOURCE  // For syscall() alongside POSIX.1-2008
+#include <ctype.h>
+#include <dirent.h>  // For scanning /proc
+#include <errno.h>
+#include <fcntl.h>  // For open()
+#include <poll.h>  // For polling pidfds
+#include <regex.h>  // For --watch-name
+#include <sys/syscall.h>  // For SYS_pidfd_open
+#include <time.h>  // For clock_gettime()
+#include "proc_watch.h"
+#include "collector.h"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434  // Same number on every architecture
+#endif
+
+// Change of PSS (or RSS) in MB shown by one bar of the graphics
+#define WATCH_MB_PER_BAR 0.1
+
+// A watched process and its persistent descriptors
+typedef struct {
+    pid_t pid;  // Process ID
+    char comm[WATCH_COMM_LEN];  // Process name
+    int pidfd;  // Pins the process; readable once it has exited
+    int stat_fd;  // /proc/[pid]/stat
+    int smaps_fd;  // /proc/[pid]/smaps_rollup, or -1 when not permitted
+    int alive;  // 0 once the exit has been seen
+    unsigned long long cpu_ticks;  // utime + stime at the previous sample
+    double last_read;  // CLOCK_MONOTONIC time in seconds of the previous sample
+} WatchedProcess;
+
+// State of the processes collector
+typedef struct {
+    WatchedProcess procs[WATCH_MAX_PROCESSES];
+    int count;  // Entries in procs
+    long ticks_per_second;  // Unit of the CPU times in stat
+    double page_mb;  // Size of a page in MB
+    char *read_buf;  // Buffer /proc/[pid]/stat and /proc/[pid]/smaps_rollup are read into
+    size_t read_buf_size;  // Capacity of read_buf
+    double *memory_history;  // PSS (or RSS) of each process at each sample, count x samples
+    int samples;  // Total number of samples
+    int graphics_flag;  // Whether to print the memory graphics
+    int sequential_flag;  // Output mode
+} ProcessCollectorState;
+
+/*
+ * Returns CLOCK_MONOTONIC in seconds.
+ */
+static double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * Reads a /proc/[pid] file into the state's buffer. Returns the number of bytes
+ * read, or -1 on error (ESRCH once the process is gone).
+ */
+static ssize_t read_proc_file(ProcessCollectorState *state, int fd) {
+    return pread_whole_file(fd, &state->read_buf, &state->read_buf_size);
+}
+
+/*
+ * Returns whether the process behind a pidfd has exited, without blocking.
+ */
+static int pidfd_exited(int pidfd) {
+    struct pollfd pfd = {pidfd, POLLIN, 0};
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+/*
+ * Parses utime + stime and the resident page count from the contents of
+ * /proc/[pid]/stat. Fields are counted after the last ')', since the process name
+ * in parentheses may itself contain spaces and parentheses. Returns 0 on success.
+ */
+static int parse_stat(const char *buf, unsigned long long *cpu_ticks, long *rss_pages) {
+    const char *p = strrchr(buf, ')');
+    if (!p) {
+        return -1;
+    }
+    unsigned long long utime = 0, stime = 0;
+    // Field 3 (state) is the first after ')'; utime, stime and rss are fields 14, 15 and 24
+    for (int field = 3; field <= 24; field++) {
+        while (*p && *p != ' ') {
+            p++;
+        }
+        while (*p == ' ') {
+            p++;
+        }
+        if (!*p) {
+            return -1;
+        }
+        if (field == 14) {
+            utime = strtoull(p, NULL, 10);
+        } else if (field == 15) {
+            stime = strtoull(p, NULL, 10);
+        } else if (field == 24) {
+            *rss_pages = strtol(p, NULL, 10);
+        }
+    }
+    *cpu_ticks = utime + stime;
+    return 0;
+}
+
+/*
+ * Returns the value in MB of a "Name:   1234 kB" line of smaps_rollup, or 0 if
+ * the line is missing. key includes the colon, so "Pss:" does not match "Pss_Anon:".
+ */
+static double smaps_value_mb(const char *buf, const char *key) {
+    size_t key_len = strlen(key);
+    const char *line = buf;
+    while (line) {
+        if (strncmp(line, key, key_len) == 0) {
+            return strtoull(line + key_len, NULL, 10) / 1024.0;
+        }
+        line = strchr(line, '\n');
+        line = line ? line + 1 : NULL;
+    }
+    return 0.0;
+}
+
+/*
+ * Reads /proc/[pid]/comm into comm, stripping the newline. Leaves comm empty on error.
+ */
+static void read_comm(pid_t pid, char comm[WATCH_COMM_LEN]) {
+    char path[64];
+    comm[0] = '\0';
+    snprintf(path, sizeof(path), "/proc/%d/comm", (int)pid);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return;
+    }
+    if (fgets(comm, WATCH_COMM_LEN, file)) {
+        comm[strcspn(comm, "\n")] = '\0';
+    }
+    fclose(file);
+}
+
+/*
+ * Starts watching a process: pins it with a pidfd, opens its stat and smaps_rollup
+ * and reads the CPU time baseline. The pidfd is checked again after the files are
+ * opened, so they cannot belong to a later process that reused the PID. Returns 0
+ * on success, -1 (with a message) if the process does not exist or already exited.
+ */
+static int watch_process(ProcessCollectorState *state, pid_t pid) {
+    WatchedProcess *proc = &state->procs[state->count];
+    char path[64];
+    long rss_pages;
+
+    for (int k = 0; k < state->count; k++) {
+        if (state->procs[k].pid == pid) {
+            return 0; // Listed twice, or matched by both --watch and --watch-name
+        }
+    }
+    if (state->count == WATCH_MAX_PROCESSES) {
+        fprintf(stderr, "Not watching PID %d: at most %d processes can be watched\n", (int)pid, WATCH_MAX_PROCESSES);
+        return -1;
+    }
+
+    proc->pid = pid;
+    proc->pidfd = syscall(SYS_pidfd_open, pid, 0);
+    if (proc->pidfd == -1) {
+        fprintf(stderr, "Not watching PID %d: %s\n", (int)pid, strerror(errno));
+        return -1;
+    }
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    proc->stat_fd = open(path, O_RDONLY);
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+    proc->smaps_fd = open(path, O_RDONLY); // Fails with EACCES for other users' processes
+    read_comm(pid, proc->comm);
+
+    if (proc->stat_fd == -1 || pidfd_exited(proc->pidfd) ||
+        read_proc_file(state, proc->stat_fd) <= 0 || parse_stat(state->read_buf, &proc->cpu_ticks, &rss_pages) != 0) {
+        fprintf(stderr, "Not watching PID %d: process exited\n", (int)pid);
+        close(proc->pidfd);
+        if (proc->stat_fd != -1) {
+            close(proc->stat_fd);
+        }
+        if (proc->smaps_fd != -1) {
+            close(proc->smaps_fd);
+        }
+        return -1;
+    }
+    proc->last_read = monotonic_seconds();
+    proc->alive = 1;
+    state->count++;
+    return 0;
+}
+
+/*
+ * Watches every PID of a comma-separated list.
+ */
+static void watch_pid_list(ProcessCollectorState *state, const char *pid_list) {
+    char list[1024];
+    char *saveptr;
+    snprintf(list, sizeof(list), "%s", pid_list);
+    for (char *item = strtok_r(list, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        char *end;
+        long pid = strtol(item, &end, 10);
+        if (*end != '\0' || pid <= 0) {
+            fprintf(stderr, "Invalid PID '%s' in --watch\n", item);
+            exit(EXIT_FAILURE);
+        }
+        watch_process(state, pid);
+    }
+}
+
+/*
+ * Watches every process whose name matches an extended regular expression. /proc is
+ * scanned once; later processes with a matching name are not picked up.
+ */
+static void watch_matching_names(ProcessCollectorState *state, const char *pattern) {
+    regex_t regex;
+    int error = regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB);
+    if (error != 0) {
+        char message[256];
+        regerror(error, &regex, message, sizeof(message));
+        fprintf(stderr, "Invalid --watch-name pattern '%s': %s\n", pattern, message);
+        exit(EXIT_FAILURE);
+    }
+
+    DIR *proc_dir = opendir("/proc");
+    if (!proc_dir) {
+        perror("/proc");
+        exit(EXIT_FAILURE);
+    }
+    pid_t self = getpid();
+    struct dirent *entry;
+    while ((entry = readdir(proc_dir)) != NULL) {
+        if (!isdigit((unsigned char)entry->d_name[0])) {
+            continue;
+        }
+        pid_t pid = atoi(entry->d_name);
+        char comm[WATCH_COMM_LEN];
+        read_comm(pid, comm);
+        if (pid != self && comm[0] && regexec(&regex, comm, 0, NULL, 0) == 0) {
+            watch_process(state, pid);
+        }
+    }
+    closedir(proc_dir);
+    regfree(&regex);
+}
+
+/*
+ * Samples one watched process into stats. A process whose pidfd has become readable
+ * has exited; its descriptors are closed and it is reported as exited from then on.
+ */
+static void sample_process(ProcessCollectorState *state, WatchedProcess *proc, ProcessStats *stats) {
+    unsigned long long cpu_ticks;
+    long rss_pages;
+
+    stats->pid = proc->pid;
+    memcpy(stats->comm, proc->comm, WATCH_COMM_LEN);
+    if (proc->alive && (pidfd_exited(proc->pidfd) || read_proc_file(state, proc->stat_fd) <= 0 ||
+                        parse_stat(state->read_buf, &cpu_ticks, &rss_pages) != 0)) {
+        proc->alive = 0;
+        close(proc->pidfd);
+        close(proc->stat_fd);
+        if (proc->smaps_fd != -1) {
+            close(proc->smaps_fd);
+        }
+    }
+    stats->alive = proc->alive;
+    if (!proc->alive) {
+        return;
+    }
+
+    double now = monotonic_seconds();
+    double elapsed = now - proc->last_read;
+    stats->cpu_usage = elapsed > 0 ? 100.0 * (cpu_ticks - proc->cpu_ticks) / state->ticks_per_second / elapsed : 0.0;
+    stats->rss_mb = rss_pages * state->page_mb;
+    proc->cpu_ticks = cpu_ticks;
+    proc->last_read = now;
+
+    stats->have_smaps = proc->smaps_fd != -1 && read_proc_file(state, proc->smaps_fd) > 0;
+    if (stats->have_smaps) {
+        stats->rss_mb = smaps_value_mb(state->read_buf, "Rss:");
+        stats->pss_mb = smaps_value_mb(state->read_buf, "Pss:");
+        stats->swap_mb = smaps_value_mb(state->read_buf, "Swap:");
+    }
+}
+
+// processes collector
+
+/**
+ * Resolves --watch and --watch-name to a fixed set of processes and opens their
+ * descriptors, taking the CPU time baseline of the first sample.
+ *
+ * @param options Program options.
+ * @param slot_size Receives the size of a slot (one ProcessSample).
+ * @return The collector state.
+ */
+static void *processes_collector_init(const MonitorOptions *options, size_t *slot_size) {
+    ProcessCollectorState *state = calloc(1, sizeof(ProcessCollectorState));
+    if (!state) {
+        perror("Failed to allocate processes collector");
+        exit(EXIT_FAILURE);
+    }
+    state->ticks_per_second = sysconf(_SC_CLK_TCK);
+    state->page_mb = sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+    state->samples = options->samples;
+    state->graphics_flag = options->graphics_flag;
+    state->sequential_flag = options->sequential_flag;
+
+    if (options->watch_pids) {
+        watch_pid_list(state, options->watch_pids);
+    }
+    if (options->watch_name) {
+        watch_matching_names(state, options->watch_name);
+    }
+
+    state->memory_history = calloc((size_t)(state->count > 0 ? state->count : 1) * (state->samples > 0 ? state->samples : 1),
+                                   sizeof(double));
+    if (!state->memory_history) {
+        perror("Failed to allocate processes collector");
+        exit(EXIT_FAILURE);
+    }
+    *slot_size = sizeof(ProcessSample);
+    return state;
+}
+
+/**
+ * Samples every watched process.
+ *
+ * @param state Collector state.
+ * @param slot ProcessSample to fill.
+ */
+static void processes_collector_sample(void *state, void *slot) {
+    ProcessCollectorState *watch = state;
+    ProcessSample *sample = slot;
+    sample->count = watch->count;
+    for (int k = 0; k < watch->count; k++) {
+        sample_process(watch, &watch->procs[k], &sample->procs[k]);
+    }
+}
+
+/*
+ * Prints one line of a process's memory graphics: its PSS (RSS when PSS is not
+ * readable) at a sample, with bars for the change since the previous sample.
+ */
+static void print_process_graphics_line(FILE *out, const double *history, int index) {
+    double diff = index == 0 ? 0 : history[index] - history[index - 1];
+    print_change_bars(out, diff, WATCH_MB_PER_BAR);
+    fprintf(out, " %+.1f MB (%.1f MB)\n", diff, history[index]);
+}
+
+/**
+ * Prints a line per watched process and, if enabled, the history of each process's
+ * memory with bars for its growth at every sample, like the virtual memory graphics.
+ *
+ * @param out Stream to print to.
+ * @param state Collector state.
+ * @param slot Sampled ProcessSample.
+ * @param sample_index Index of the current sample.
+ */
+static void processes_collector_render(FILE *out, void *state, const void *slot, int sample_index) {
+    ProcessCollectorState *watch = state;
+    const ProcessSample *sample = slot;
+
+    fprintf(out, "### Processes ### (CPU%% of one core, memory in MB)\n");
+    if (sample->count == 0) {
+        fprintf(out, " (no processes watched)\n");
+        return;
+    }
+    fprintf(out, " %7s %-16s %7s %9s %9s %9s\n", "PID", "COMMAND", "CPU%", "RSS", "PSS", "SWAP");
+    for (int k = 0; k < sample->count; k++) {
+        const ProcessStats *stats = &sample->procs[k];
+        double *history = watch->memory_history + (size_t)k * watch->samples;
+        if (!stats->alive) {
+            fprintf(out, " %7d %-16s  (exited)\n", (int)stats->pid, stats->comm);
+            if (sample_index > 0) {
+                history[sample_index] = history[sample_index - 1];
+            }
+            continue;
+        }
+        if (stats->have_smaps) {
+            fprintf(out, " %7d %-16s %7.2f %9.1f %9.1f %9.1f\n", (int)stats->pid, stats->comm,
+                   stats->cpu_usage, stats->rss_mb, stats->pss_mb, stats->swap_mb);
+        } else {
+            fprintf(out, " %7d %-16s %7.2f %9.1f %9s %9s\n", (int)stats->pid, stats->comm,
+                   stats->cpu_usage, stats->rss_mb, "-", "-");
+        }
+        history[sample_index] = stats->have_smaps ? stats->pss_mb : stats->rss_mb;
+    }
+
+    if (!watch->graphics_flag) {
+        return;
+    }
+    for (int k = 0; k < sample->count; k++) {
+        const ProcessStats *stats = &sample->procs[k];
+        const double *history = watch->memory_history + (size_t)k * watch->samples;
+        fprintf(out, " %d %s (%s)\n", (int)stats->pid, stats->comm, stats->have_smaps ? "PSS" : "RSS");
+        if (watch->sequential_flag) {
+            print_process_graphics_line(out, history, sample_index);
+        } else {
+            for (int i = 0; i <= sample_index; i++) {
+                print_process_graphics_line(out, history, i);
+            }
+        }
+    }
+}
+
+/**
+ * Closes the descriptors of the processes still alive and frees the state.
+ *
+ * @param state Collector state.
+ */
+static void processes_collector_teardown(void *state) {
+    ProcessCollectorState *watch = state;
+    for (int k = 0; k < watch->count; k++) {
+        WatchedProcess *proc = &watch->procs[k];
+        if (proc->alive) {
+            close(proc->pidfd);
+            close(proc->stat_fd);
+            if (proc->smaps_fd != -1) {
+                close(proc->smaps_fd);
+            }
+        }
+    }
+    free(watch->memory_history);
+    free(watch->read_buf);
+    free(watch);
+}
+
+const Collector processes_collector = {
+    "processes", processes_collector_init, processes_collector_sample,
+    processes_collector_render, NULL, processes_collector_teardown
+};
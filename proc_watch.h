@@ -0,0 +1,40 @@
+// Guard to prevent double inclusion of the header file
+#ifndef PROC_WATCH_H
+#define PROC_WATCH_H
+
+// Watch list of specific processes (--watch, --watch-name).
+//
+// Each watched process is pinned with a pidfd, so its exit is noticed with a
+// non-blocking poll() and a later process reusing the PID is never mistaken for it.
+// Its /proc/[pid]/stat and /proc/[pid]/smaps_rollup stay open and are re-read with
+// pread() every sample for CPU%, RSS, PSS and swap.
+
+#include <sys/types.h>
+#include "stats_functions.h"
+
+// Most processes tracked at once
+#define WATCH_MAX_PROCESSES 32
+
+// Length kept of a process name (the kernel's comm is at most 15 characters)
+#define WATCH_COMM_LEN 16
+
+// Measurements of one watched process in one sample
+typedef struct {
+    pid_t pid;  // Process ID
+    char comm[WATCH_COMM_LEN];  // Process name
+    int alive;  // 0 once the process has exited
+    int have_smaps;  // Whether PSS and swap could be read (needs ptrace access)
+    double cpu_usage;  // CPU usage since the previous sample, in percent of one core
+    double rss_mb;  // Resident set size
+    double pss_mb;  // Proportional set size
+    double swap_mb;  // Swapped-out memory
+} ProcessStats;
+
+// Slot of the processes collector
+typedef struct {
+    int count;  // Entries in procs
+    ProcessStats procs[WATCH_MAX_PROCESSES];
+} ProcessSample;
+
+// End of the include guard
+#endif
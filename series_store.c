@@ -0,0 +1,557 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include "series_store.h"
+
+// Each block is sized to hold at least this many samples in the worst case
+#define SERIES_MIN_SAMPLES_PER_BLOCK 64
+
+// Smallest block size; larger sample widths round up to the next power of two
+#define SERIES_MIN_BLOCK_SIZE 4096
+
+// The block being filled is written out in place every this many samples, so a
+// crash loses at most that many samples instead of a whole block
+#define SERIES_SYNC_SAMPLES 60
+
+// Encoder state: the block being filled plus the Gorilla predictor state
+struct SeriesWriter {
+    FILE *fp;  // Recording being written
+    int n_series;  // Values per sample
+    uint32_t block_size;  // Bytes per block
+    off_t block_offset;  // File offset of the current block
+    uint32_t unsynced;  // Samples appended since the current block was last written
+    unsigned char *block;  // Current block: header, ranges, then payload
+    SeriesRange *ranges;  // Per-series min/max inside the block
+    unsigned char *payload;  // Start of the compressed bit stream
+    uint32_t capacity_bits;  // Size of the payload area in bits
+    uint32_t bit_pos;  // Next free bit in the payload
+    uint32_t count;  // Samples in the current block
+    int64_t first_ms, prev_ms, prev_delta;  // Timestamp predictor
+    uint64_t *prev_value;  // Raw bits of the previous value of each series
+    int *prev_leading, *prev_trailing;  // Current XOR window of each series (-1 = none)
+};
+
+// Decoder state: the block most recently loaded by series_reader_next_block()
+struct SeriesReader {
+    FILE *fp;  // Recording being read
+    int n_series;  // Values per sample
+    uint32_t block_size;  // Bytes per block
+    unsigned char *block;  // Loaded block
+    uint64_t *prev_value;  // Same predictor state as the writer
+    int *prev_leading, *prev_trailing;
+};
+
+/*
+ * Returns the worst-case number of payload bits one sample can take: a 4-bit
+ * timestamp prefix plus a 64-bit delta-of-delta, and per value a 2-bit control
+ * prefix, 5 bits of leading zeros, 6 bits of length and 64 meaningful bits.
+ */
+static uint32_t worst_case_sample_bits(int n_series) {
+    return 4 + 64 + (uint32_t)n_series * (2 + 5 + 6 + 64);
+}
+
+/*
+ * Returns the byte offset of the payload inside a block.
+ */
+static size_t payload_offset(int n_series) {
+    return sizeof(SeriesBlockHeader) + n_series * sizeof(SeriesRange);
+}
+
+/*
+ * Appends the low nbits (1..64) of value to a zero-filled bit stream, MSB first.
+ */
+static void put_bits(unsigned char *buf, uint32_t *pos, uint64_t value, int nbits) {
+    while (nbits > 0) {
+        int room = 8 - (*pos & 7);
+        int take = nbits < room ? nbits : room;
+        unsigned chunk = (value >> (nbits - take)) & ((1u << take) - 1);
+        buf[*pos >> 3] |= chunk << (room - take);
+        *pos += take;
+        nbits -= take;
+    }
+}
+
+/*
+ * Reads nbits (1..64) from a bit stream, MSB first. Reading past limit sets *overrun.
+ */
+static uint64_t get_bits(const unsigned char *buf, uint32_t *pos, uint32_t limit, int nbits, int *overrun) {
+    uint64_t value = 0;
+    if (*pos + nbits > limit) {
+        *overrun = 1;
+        return 0;
+    }
+    while (nbits > 0) {
+        int room = 8 - (*pos & 7);
+        int take = nbits < room ? nbits : room;
+        unsigned chunk = (buf[*pos >> 3] >> (room - take)) & ((1u << take) - 1);
+        value = (value << take) | chunk;
+        *pos += take;
+        nbits -= take;
+    }
+    return value;
+}
+
+/*
+ * Reinterprets a double as its raw 64 bits and back.
+ */
+static uint64_t double_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double bits_double(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*
+ * Sign-extends the low nbits of value.
+ */
+static int64_t sign_extend(uint64_t value, int nbits) {
+    uint64_t sign = 1ull << (nbits - 1);
+    return (int64_t)((value ^ sign) - sign);
+}
+
+/*
+ * Clears the current block and the per-block predictor state.
+ */
+static void reset_block(SeriesWriter *writer) {
+    memset(writer->block, 0, writer->block_size);
+    for (int s = 0; s < writer->n_series; s++) {
+        writer->ranges[s].min = INFINITY;
+        writer->ranges[s].max = -INFINITY;
+    }
+    writer->bit_pos = 0;
+    writer->count = 0;
+}
+
+/*
+ * Fills in the block header and writes the whole fixed-size block at its offset,
+ * then hands it to the kernel. A partial block written this way is a valid last
+ * block; it is overwritten in place as it fills.
+ */
+static void write_block(SeriesWriter *writer) {
+    SeriesBlockHeader *header = (SeriesBlockHeader *)writer->block;
+    header->magic = SERIES_BLOCK_MAGIC;
+    header->count = writer->count;
+    header->first_ms = writer->first_ms;
+    header->last_ms = writer->prev_ms;
+    header->payload_bits = writer->bit_pos;
+
+    if (fseeko(writer->fp, writer->block_offset, SEEK_SET) != 0 ||
+        fwrite(writer->block, writer->block_size, 1, writer->fp) != 1 || fflush(writer->fp) != 0) {
+        perror("Failed to write recording block");
+        exit(EXIT_FAILURE);
+    }
+    writer->unsynced = 0;
+}
+
+/*
+ * Writes the current block and starts the next one after it.
+ */
+static void flush_block(SeriesWriter *writer) {
+    write_block(writer);
+    writer->block_offset += writer->block_size;
+    reset_block(writer);
+}
+
+/*
+ * Opens the recording at path for appending, creating it with a file header if it
+ * is missing or empty. An existing recording must have been written with the same
+ * number of series; bytes of a block cut short by a crash are dropped. Sets the
+ * writer's file and the offset of its first block. Exits the program on failure.
+ */
+static void open_recording(SeriesWriter *writer, const char *path) {
+    SeriesFileHeader file_header = {SERIES_FILE_MAGIC, SERIES_VERSION, (uint32_t)writer->n_series, writer->block_size};
+    SeriesFileHeader existing;
+
+    writer->fp = fopen(path, "r+b");
+    if (!writer->fp && errno == ENOENT) {
+        writer->fp = fopen(path, "w+b");
+    }
+    if (!writer->fp) {
+        perror("Failed to open recording");
+        exit(EXIT_FAILURE);
+    }
+
+    if (fread(&existing, sizeof(existing), 1, writer->fp) != 1) {
+        if (ferror(writer->fp) || ftello(writer->fp) != 0) {
+            fprintf(stderr, "%s is not a recording\n", path);
+            exit(EXIT_FAILURE);
+        }
+        // New or empty file
+        if (fwrite(&file_header, sizeof(file_header), 1, writer->fp) != 1 || fflush(writer->fp) != 0) {
+            perror("Failed to write recording header");
+            exit(EXIT_FAILURE);
+        }
+        writer->block_offset = sizeof(file_header);
+        return;
+    }
+
+    if (existing.magic != SERIES_FILE_MAGIC || existing.version != SERIES_VERSION) {
+        fprintf(stderr, "%s is not a recording\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (existing.n_series != file_header.n_series || existing.block_size != file_header.block_size) {
+        fprintf(stderr, "%s holds %u series per sample, but %u are recorded here\n", path, existing.n_series, file_header.n_series);
+        exit(EXIT_FAILURE);
+    }
+
+    if (fseeko(writer->fp, 0, SEEK_END) != 0) {
+        perror("Failed to seek in recording");
+        exit(EXIT_FAILURE);
+    }
+    off_t blocks = (ftello(writer->fp) - (off_t)sizeof(existing)) / writer->block_size;
+    writer->block_offset = sizeof(existing) + blocks * writer->block_size;
+    if (ftruncate(fileno(writer->fp), writer->block_offset) != 0) {
+        perror("Failed to truncate recording");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Opens a recording for appending, creating it (with its file header) if it does
+ * not exist. The block size is the smallest power of two (at least 4 KiB) that fits
+ * SERIES_MIN_SAMPLES_PER_BLOCK samples even if none of them compress. New samples
+ * go into new blocks after the existing ones. Exits the program on failure, or if
+ * the file is not a recording of n_series values per sample.
+ *
+ * @param path Recording to append to.
+ * @param n_series Number of values in every sample.
+ * @return Encoder to feed with series_writer_append().
+ */
+SeriesWriter *series_writer_open(const char *path, int n_series) {
+    SeriesWriter *writer = calloc(1, sizeof(SeriesWriter));
+    if (!writer) {
+        perror("Failed to allocate series writer");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t needed = payload_offset(n_series) +
+                    (SERIES_MIN_SAMPLES_PER_BLOCK * (size_t)worst_case_sample_bits(n_series) + 7) / 8;
+    writer->block_size = SERIES_MIN_BLOCK_SIZE;
+    while (writer->block_size < needed) {
+        writer->block_size *= 2;
+    }
+
+    writer->n_series = n_series;
+    writer->block = malloc(writer->block_size);
+    writer->prev_value = calloc(n_series, sizeof(uint64_t));
+    writer->prev_leading = calloc(n_series, sizeof(int));
+    writer->prev_trailing = calloc(n_series, sizeof(int));
+    if (!writer->block || !writer->prev_value || !writer->prev_leading || !writer->prev_trailing) {
+        perror("Failed to allocate series writer");
+        exit(EXIT_FAILURE);
+    }
+    writer->ranges = (SeriesRange *)(writer->block + sizeof(SeriesBlockHeader));
+    writer->payload = writer->block + payload_offset(n_series);
+    writer->capacity_bits = (writer->block_size - payload_offset(n_series)) * 8;
+    reset_block(writer);
+    open_recording(writer, path);
+    return writer;
+}
+
+/*
+ * Encodes a timestamp delta-of-delta with Gorilla's variable-length buckets.
+ */
+static void put_timestamp(SeriesWriter *writer, int64_t dod) {
+    if (dod == 0) {
+        put_bits(writer->payload, &writer->bit_pos, 0x0, 1);
+    } else if (dod >= -64 && dod < 64) {
+        put_bits(writer->payload, &writer->bit_pos, 0x2, 2);
+        put_bits(writer->payload, &writer->bit_pos, (uint64_t)dod, 7);
+    } else if (dod >= -256 && dod < 256) {
+        put_bits(writer->payload, &writer->bit_pos, 0x6, 3);
+        put_bits(writer->payload, &writer->bit_pos, (uint64_t)dod, 9);
+    } else if (dod >= -2048 && dod < 2048) {
+        put_bits(writer->payload, &writer->bit_pos, 0xE, 4);
+        put_bits(writer->payload, &writer->bit_pos, (uint64_t)dod, 12);
+    } else {
+        put_bits(writer->payload, &writer->bit_pos, 0xF, 4);
+        put_bits(writer->payload, &writer->bit_pos, (uint64_t)dod, 64);
+    }
+}
+
+/*
+ * Encodes one value as the XOR with the previous value of its series. An unchanged
+ * value takes one bit; otherwise the meaningful bits are written either inside the
+ * previous leading/trailing-zero window or with a new window.
+ */
+static void put_value(SeriesWriter *writer, int series, uint64_t bits) {
+    uint64_t xored = bits ^ writer->prev_value[series];
+    writer->prev_value[series] = bits;
+
+    if (xored == 0) {
+        put_bits(writer->payload, &writer->bit_pos, 0x0, 1);
+        return;
+    }
+
+    int leading = __builtin_clzll(xored);
+    int trailing = __builtin_ctzll(xored);
+    if (leading > 31) {
+        leading = 31; // Only 5 bits are available to store it
+    }
+
+    int prev_leading = writer->prev_leading[series];
+    int prev_trailing = writer->prev_trailing[series];
+    if (prev_leading >= 0 && leading >= prev_leading && trailing >= prev_trailing) {
+        // Fits the previous window: no need to repeat its size
+        put_bits(writer->payload, &writer->bit_pos, 0x2, 2);
+        put_bits(writer->payload, &writer->bit_pos, xored >> prev_trailing, 64 - prev_leading - prev_trailing);
+    } else {
+        int length = 64 - leading - trailing;
+        put_bits(writer->payload, &writer->bit_pos, 0x3, 2);
+        put_bits(writer->payload, &writer->bit_pos, leading, 5);
+        put_bits(writer->payload, &writer->bit_pos, length & 63, 6); // 64 is stored as 0
+        put_bits(writer->payload, &writer->bit_pos, xored >> trailing, length);
+        writer->prev_leading[series] = leading;
+        writer->prev_trailing[series] = trailing;
+    }
+}
+
+/**
+ * Appends one sample. The first sample of a block is stored raw; the others as
+ * timestamp delta-of-deltas and value XORs. A block is written out as soon as the
+ * next sample might not fit, and in place every SERIES_SYNC_SAMPLES samples before that.
+ *
+ * @param writer Encoder returned by series_writer_open().
+ * @param timestamp_ms Time of the sample in milliseconds.
+ * @param values The n_series values of the sample; NaN marks a value not sampled.
+ */
+void series_writer_append(SeriesWriter *writer, int64_t timestamp_ms, const double *values) {
+    if (writer->count > 0 && writer->bit_pos + worst_case_sample_bits(writer->n_series) > writer->capacity_bits) {
+        flush_block(writer);
+    }
+
+    if (writer->count == 0) {
+        // Block start: raw timestamp and values, fresh predictors
+        put_bits(writer->payload, &writer->bit_pos, (uint64_t)timestamp_ms, 64);
+        for (int s = 0; s < writer->n_series; s++) {
+            writer->prev_value[s] = double_bits(values[s]);
+            writer->prev_leading[s] = -1;
+            writer->prev_trailing[s] = -1;
+            put_bits(writer->payload, &writer->bit_pos, writer->prev_value[s], 64);
+        }
+        writer->first_ms = timestamp_ms;
+        writer->prev_delta = 0;
+    } else {
+        int64_t delta = timestamp_ms - writer->prev_ms;
+        put_timestamp(writer, delta - writer->prev_delta);
+        writer->prev_delta = delta;
+        for (int s = 0; s < writer->n_series; s++) {
+            put_value(writer, s, double_bits(values[s]));
+        }
+    }
+    writer->prev_ms = timestamp_ms;
+
+    // Keep the block's min/max current so readers can skip it
+    for (int s = 0; s < writer->n_series; s++) {
+        if (values[s] < writer->ranges[s].min) {
+            writer->ranges[s].min = values[s];
+        }
+        if (values[s] > writer->ranges[s].max) {
+            writer->ranges[s].max = values[s];
+        }
+    }
+    writer->count++;
+
+    if (++writer->unsynced == SERIES_SYNC_SAMPLES) {
+        write_block(writer);
+    }
+}
+
+/**
+ * Writes out the partially filled last block and closes the recording.
+ *
+ * @param writer Encoder returned by series_writer_open(); freed by this call.
+ */
+void series_writer_close(SeriesWriter *writer) {
+    if (writer->count > 0) {
+        flush_block(writer);
+    }
+    if (fclose(writer->fp) != 0) {
+        perror("Failed to close recording");
+        exit(EXIT_FAILURE);
+    }
+    free(writer->block);
+    free(writer->prev_value);
+    free(writer->prev_leading);
+    free(writer->prev_trailing);
+    free(writer);
+}
+
+/**
+ * Opens a recording and validates its file header.
+ *
+ * @param path Recording written by series_writer_open().
+ * @return Decoder, or NULL with errno set if the file cannot be read or is not a recording.
+ */
+SeriesReader *series_reader_open(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return NULL;
+    }
+
+    SeriesFileHeader file_header;
+    if (fread(&file_header, sizeof(file_header), 1, fp) != 1 ||
+        file_header.magic != SERIES_FILE_MAGIC || file_header.version != SERIES_VERSION ||
+        file_header.n_series == 0 || file_header.block_size < payload_offset(file_header.n_series)) {
+        fclose(fp);
+        errno = EPROTO;
+        return NULL;
+    }
+
+    SeriesReader *reader = calloc(1, sizeof(SeriesReader));
+    if (!reader) {
+        fclose(fp);
+        return NULL;
+    }
+    reader->fp = fp;
+    reader->n_series = file_header.n_series;
+    reader->block_size = file_header.block_size;
+    reader->block = malloc(reader->block_size);
+    reader->prev_value = calloc(reader->n_series, sizeof(uint64_t));
+    reader->prev_leading = calloc(reader->n_series, sizeof(int));
+    reader->prev_trailing = calloc(reader->n_series, sizeof(int));
+    if (!reader->block || !reader->prev_value || !reader->prev_leading || !reader->prev_trailing) {
+        series_reader_close(reader);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return reader;
+}
+
+/**
+ * Returns the number of values per sample in the recording.
+ */
+int series_reader_series_count(const SeriesReader *reader) {
+    return reader->n_series;
+}
+
+/**
+ * Loads the next block. Its header and ranges can be inspected to decide whether
+ * the block is worth decoding; skipping a block costs nothing more than this call.
+ *
+ * @param reader Decoder returned by series_reader_open().
+ * @param ranges If not NULL, receives the per-series min/max of the block.
+ * @return The block header, or NULL at the end of the recording or on a corrupt block.
+ */
+const SeriesBlockHeader *series_reader_next_block(SeriesReader *reader, const SeriesRange **ranges) {
+    if (fread(reader->block, reader->block_size, 1, reader->fp) != 1) {
+        return NULL;
+    }
+    const SeriesBlockHeader *header = (const SeriesBlockHeader *)reader->block;
+    if (header->magic != SERIES_BLOCK_MAGIC ||
+        header->payload_bits > (reader->block_size - payload_offset(reader->n_series)) * 8) {
+        return NULL;
+    }
+    if (ranges) {
+        *ranges = (const SeriesRange *)(reader->block + sizeof(SeriesBlockHeader));
+    }
+    return header;
+}
+
+/**
+ * Decodes the block loaded by the last series_reader_next_block() call.
+ *
+ * @param reader Decoder returned by series_reader_open().
+ * @param timestamps Receives the count timestamps of the block.
+ * @param values Receives count * n_series values, one sample after another.
+ * @return 0 on success, -1 if the payload is corrupt.
+ */
+int series_reader_decode_block(SeriesReader *reader, int64_t *timestamps, double *values) {
+    const SeriesBlockHeader *header = (const SeriesBlockHeader *)reader->block;
+    const unsigned char *payload = reader->block + payload_offset(reader->n_series);
+    uint32_t limit = header->payload_bits;
+    uint32_t pos = 0;
+    int overrun = 0;
+    int n = reader->n_series;
+    int64_t prev_ms = 0, prev_delta = 0;
+
+    for (uint32_t i = 0; i < header->count && !overrun; i++) {
+        double *sample = values + (size_t)i * n;
+        if (i == 0) {
+            prev_ms = (int64_t)get_bits(payload, &pos, limit, 64, &overrun);
+            for (int s = 0; s < n; s++) {
+                reader->prev_value[s] = get_bits(payload, &pos, limit, 64, &overrun);
+                reader->prev_leading[s] = -1;
+                reader->prev_trailing[s] = -1;
+                sample[s] = bits_double(reader->prev_value[s]);
+            }
+            timestamps[i] = prev_ms;
+            continue;
+        }
+
+        // Timestamp: count the leading 1s of the prefix (at most 4) to find the bucket
+        int ones = 0;
+        while (ones < 4 && get_bits(payload, &pos, limit, 1, &overrun)) {
+            ones++;
+        }
+        static const int dod_bits[] = {0, 7, 9, 12, 64};
+        int64_t dod = ones == 0 ? 0 : sign_extend(get_bits(payload, &pos, limit, dod_bits[ones], &overrun), dod_bits[ones]);
+        prev_delta += dod;
+        prev_ms += prev_delta;
+        timestamps[i] = prev_ms;
+
+        for (int s = 0; s < n; s++) {
+            if (get_bits(payload, &pos, limit, 1, &overrun)) {
+                int leading, trailing;
+                if (get_bits(payload, &pos, limit, 1, &overrun)) {
+                    // New window
+                    leading = (int)get_bits(payload, &pos, limit, 5, &overrun);
+                    int length = (int)get_bits(payload, &pos, limit, 6, &overrun);
+                    if (length == 0) {
+                        length = 64;
+                    }
+                    trailing = 64 - leading - length;
+                    if (trailing < 0) {
+                        return -1;
+                    }
+                    reader->prev_leading[s] = leading;
+                    reader->prev_trailing[s] = trailing;
+                } else {
+                    // Previous window
+                    leading = reader->prev_leading[s];
+                    trailing = reader->prev_trailing[s];
+                    if (leading < 0) {
+                        return -1;
+                    }
+                }
+                uint64_t xored = get_bits(payload, &pos, limit, 64 - leading - trailing, &overrun) << trailing;
+                reader->prev_value[s] ^= xored;
+            }
+            sample[s] = bits_double(reader->prev_value[s]);
+        }
+    }
+    return overrun ? -1 : 0;
+}
+
+/**
+ * Tells whether a block can contain values of a series inside [lo, hi], based on
+ * the min/max stored in its header. A block where the series was never sampled
+ * (all NaN) cannot match.
+ *
+ * @param ranges Ranges returned by series_reader_next_block().
+ * @param series Index of the series.
+ * @param lo Lower bound of the query.
+ * @param hi Upper bound of the query.
+ * @return 1 if the block must be decoded, 0 if it can be skipped.
+ */
+int series_block_may_contain(const SeriesRange *ranges, int series, double lo, double hi) {
+    return ranges[series].max >= lo && ranges[series].min <= hi;
+}
+
+/**
+ * Closes a recording and frees the decoder.
+ *
+ * @param reader Decoder returned by series_reader_open(); freed by this call.
+ */
+void series_reader_close(SeriesReader *reader) {
+    fclose(reader->fp);
+    free(reader->block);
+    free(reader->prev_value);
+    free(reader->prev_leading);
+    free(reader->prev_trailing);
+    free(reader);
+}
@@ -0,0 +1,84 @@
+// Guard to prevent double inclusion of the header file
+#ifndef SERIES_STORE_H
+#define SERIES_STORE_H
+
+// Compressed on-disk storage for long recordings of the sampled series.
+//
+// A recording is a file header followed by fixed-size blocks; later runs append
+// blocks to an existing recording. The block being filled is rewritten in place
+// periodically, so a crash only loses the last few samples. Inside a block,
+// timestamps (milliseconds) are stored as delta-of-deltas and every series value
+// is XORed with the previous value of the same series, as in Facebook's Gorilla
+// time-series store. Each block header carries the time span and the min/max of
+// every series so range queries can skip blocks without decoding them.
+// All fields are written in the host's byte order.
+
+#include <stdint.h>
+#include "stats_functions.h"
+
+// File and block magic numbers ("SYSR" and "SYSB") and format version
+#define SERIES_FILE_MAGIC 0x52535953u
+#define SERIES_BLOCK_MAGIC 0x42535953u
+#define SERIES_VERSION 1u
+
+// Number of series always recorded before the per-core values:
+// total CPU %, then the four MemoryStats fields
+#define SERIES_FIXED_COUNT 5
+
+// Header at the start of a recording
+typedef struct {
+    uint32_t magic;  // SERIES_FILE_MAGIC
+    uint32_t version;  // SERIES_VERSION
+    uint32_t n_series;  // Values per sample
+    uint32_t block_size;  // Size in bytes of every block that follows
+} SeriesFileHeader;
+
+// Header at the start of every block, followed by n_series SeriesRange entries
+typedef struct {
+    uint32_t magic;  // SERIES_BLOCK_MAGIC
+    uint32_t count;  // Samples encoded in the block
+    int64_t first_ms;  // Timestamp of the first sample
+    int64_t last_ms;  // Timestamp of the last sample
+    uint32_t payload_bits;  // Bits used in the compressed payload
+    uint32_t reserved;
+} SeriesBlockHeader;
+
+// Smallest and largest value of one series within a block (NaNs excluded)
+typedef struct {
+    double min;
+    double max;
+} SeriesRange;
+
+// Opaque encoder and decoder state
+typedef struct SeriesWriter SeriesWriter;
+typedef struct SeriesReader SeriesReader;
+
+// Opens (or creates) a recording at path holding n_series values per sample for appending
+SeriesWriter *series_writer_open(const char *path, int n_series);
+
+// Appends one sample (n_series values) taken at timestamp_ms
+void series_writer_append(SeriesWriter *writer, int64_t timestamp_ms, const double *values);
+
+// Flushes the last block and closes the recording
+void series_writer_close(SeriesWriter *writer);
+
+// Opens a recording for decoding; returns NULL with errno set on failure
+SeriesReader *series_reader_open(const char *path);
+
+// Returns the number of values per sample in the recording
+int series_reader_series_count(const SeriesReader *reader);
+
+// Loads the next block; returns its header (ranges in *ranges) or NULL at the end
+const SeriesBlockHeader *series_reader_next_block(SeriesReader *reader, const SeriesRange **ranges);
+
+// Decodes the loaded block into timestamps[count] and values[count * n_series]
+int series_reader_decode_block(SeriesReader *reader, int64_t *timestamps, double *values);
+
+// Tells whether a block can hold values of a series within [lo, hi]
+int series_block_may_contain(const SeriesRange *ranges, int series, double lo, double hi);
+
+// Closes a recording opened with series_reader_open()
+void series_reader_close(SeriesReader *reader);
+
+// End of the include guard
+#endif
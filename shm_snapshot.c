@@ -0,0 +1,155 @@
+#define _DEFAULT_SOURCE  // For flock() alongside POSIX.1-2008
+#include <errno.h>
+#include <fcntl.h>  // For O_* constants
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/file.h>  // For flock()
+#include <sys/mman.h>  // For shm_open() and mmap()
+#include <sys/stat.h>  // For fstat()
+#include "shm_snapshot.h"
+
+// Descriptor of the segment this process writes, kept open because it holds the
+// writer lock; a process publishes to at most one segment
+static int writer_fd = -1;
+
+/**
+ * Creates the named shared memory segment, or reuses the one an earlier run left
+ * behind, locks it so no second writer can publish to it, maps it read-write and
+ * publishes an empty sample. An existing segment is never shrunk, so readers still
+ * mapping it keep valid pages. Exits the program on failure.
+ *
+ * @param name Segment name as understood by shm_open(), e.g. "/sys_stats".
+ * @return Pointer to the mapped segment.
+ */
+SharedSegment *shm_snapshot_create(const char *name) {
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        perror("shm_open");
+        exit(EXIT_FAILURE);
+    }
+
+    // A second writer would break the single-writer seqlock, then unlink our segment on exit
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+        if (errno == EWOULDBLOCK) {
+            fprintf(stderr, "Shared memory segment %s is already published by another process\n", name);
+        } else {
+            perror("flock");
+        }
+        exit(EXIT_FAILURE);
+    }
+
+    // Size the segment to hold exactly one header and payload
+    if (ftruncate(fd, sizeof(SharedSegment)) == -1) {
+        perror("ftruncate");
+        exit(EXIT_FAILURE);
+    }
+
+    SharedSegment *segment = mmap(NULL, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (segment == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    writer_fd = fd;
+
+    // Clear the payload under the seqlock. A reused segment keeps its counter, which is
+    // odd if the earlier writer died mid-write; it stays odd until the payload is clean.
+    uint64_t seq = __atomic_load_n(&segment->seq, __ATOMIC_RELAXED) | 1;
+    __atomic_store_n(&segment->seq, seq, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < SHM_SAMPLE_WORDS; i++) {
+        __atomic_store_n(&segment->words[i], 0, __ATOMIC_RELAXED);
+    }
+    segment->magic = SHM_SNAPSHOT_MAGIC;
+    segment->version = SHM_SNAPSHOT_VERSION;
+    __atomic_store_n(&segment->seq, seq + 1, __ATOMIC_RELEASE);
+    return segment;
+}
+
+/**
+ * Publishes a sample under the seqlock. The counter is made odd before the payload
+ * is touched and even again afterwards, so readers can detect an overlapping write.
+ * Only one writer per segment is supported.
+ *
+ * @param segment Segment returned by shm_snapshot_create().
+ * @param sample Sample to publish.
+ */
+void shm_snapshot_publish(SharedSegment *segment, const SharedSample *sample) {
+    uint64_t words[SHM_SAMPLE_WORDS];
+    memcpy(words, sample, sizeof(*sample));
+
+    uint64_t seq = __atomic_load_n(&segment->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&segment->seq, seq + 1, __ATOMIC_RELAXED);
+    // Make the odd counter visible before any payload store
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < SHM_SAMPLE_WORDS; i++) {
+        __atomic_store_n(&segment->words[i], words[i], __ATOMIC_RELAXED);
+    }
+    // Release: the payload stores happen before the counter turns even again
+    __atomic_store_n(&segment->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Unmaps the segment and unlinks its name so it does not outlive the writer. The
+ * writer lock is released only after the name is gone.
+ *
+ * @param segment Segment returned by shm_snapshot_create().
+ * @param name Name the segment was created with.
+ */
+void shm_snapshot_destroy(SharedSegment *segment, const char *name) {
+    munmap(segment, sizeof(SharedSegment));
+    shm_unlink(name);
+    close(writer_fd);
+    writer_fd = -1;
+}
+
+/**
+ * Maps an existing segment read-only for a reader. This is the only call on the
+ * reader side that enters the kernel; shm_snapshot_read() works on the mapping.
+ *
+ * @param name Segment name the writer was started with.
+ * @return Pointer to the mapped segment, or NULL with errno set: EAGAIN if the
+ *         writer has not finished creating it, EPROTO if it was written by an
+ *         incompatible version, or the error of shm_open() or mmap().
+ */
+const SharedSegment *shm_snapshot_open(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    // Mapping past the end of a segment that is not sized yet would raise SIGBUS on access
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(SharedSegment)) {
+        close(fd);
+        errno = EAGAIN;
+        return NULL;
+    }
+
+    const SharedSegment *segment = mmap(NULL, sizeof(SharedSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        return NULL;
+    }
+
+    // Refuse segments that are not stamped yet or were laid out by another version of the writer
+    if (segment->magic != SHM_SNAPSHOT_MAGIC || segment->version != SHM_SNAPSHOT_VERSION) {
+        errno = segment->magic == 0 ? EAGAIN : EPROTO;
+        munmap((void *)segment, sizeof(SharedSegment));
+        return NULL;
+    }
+    return segment;
+}
+
+/**
+ * Unmaps a segment obtained from shm_snapshot_open().
+ *
+ * @param segment Segment to unmap.
+ */
+void shm_snapshot_close(const SharedSegment *segment) {
+    munmap((void *)segment, sizeof(SharedSegment));
+}
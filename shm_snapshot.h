@@ -0,0 +1,138 @@
+// Guard to prevent double inclusion of the header file
+#ifndef SHM_SNAPSHOT_H
+#define SHM_SNAPSHOT_H
+
+// Shared-memory publication of the latest sample.
+//
+// The writer (sys_stats --shm) owns a small POSIX shared memory segment and
+// publishes one SharedSample per tick under a seqlock. Readers map the segment
+// once with shm_snapshot_open() and then call shm_snapshot_read(), which never
+// takes a lock or enters the kernel: it copies the payload and retries if the
+// sequence counter shows that a write overlapped the copy. Only a reader that keeps
+// racing yields the CPU now and then, so a preempted writer can finish. The retries
+// are capped, so a writer that died in the middle of a publish cannot hang its readers.
+//
+// This header is self-contained, so external readers need nothing else from the tool.
+
+#include <errno.h>
+#include <sched.h>  // For sched_yield()
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>  // For memcpy()
+
+// Default segment name, as passed to shm_open()
+#define SHM_SNAPSHOT_DEFAULT_NAME "/sys_stats"
+
+// Identifies a segment written by this tool ("SYSS") and its layout version
+#define SHM_SNAPSHOT_MAGIC 0x53595353u
+#define SHM_SNAPSHOT_VERSION 1u
+
+// Bits in SharedSample.flags telling which fields were sampled this tick
+#define SHM_HAVE_CPU 0x1u
+#define SHM_HAVE_MEMORY 0x2u
+#define SHM_HAVE_SESSIONS 0x4u
+
+// Most retries shm_snapshot_read() makes before giving up, and how many it makes
+// between yields of the CPU. A publish takes well under a microsecond, so failing
+// every retry across a thousand yields means the writer is stuck.
+#define SHM_SNAPSHOT_MAX_RETRIES (1 << 20)
+#define SHM_SNAPSHOT_RETRIES_PER_YIELD 1024
+
+// Memory usage in GB, as published. Filled field by field from the tool's MemoryStats,
+// so the segment layout does not change when that struct does.
+typedef struct {
+    double phys_used;  // Physical memory used
+    double phys_total;  // Total physical memory
+    double virt_used;  // Virtual memory used
+    double virt_total;  // Total virtual memory
+} SharedMemory;
+
+// One published sample; plain data, copied in and out as 64-bit words
+typedef struct {
+    uint64_t timestamp_ns;  // CLOCK_REALTIME when sampling of this tick finished
+    uint64_t sample_index;  // Iteration number of the sample
+    uint32_t flags;  // SHM_HAVE_* bits
+    int32_t session_count;  // Number of user sessions
+    double cpu_usage;  // Total CPU usage in percent
+    SharedMemory memory;  // Memory usage in GB
+} SharedSample;
+
+// Size of the payload in 64-bit words (the struct is 8-byte aligned)
+#define SHM_SAMPLE_WORDS (sizeof(SharedSample) / sizeof(uint64_t))
+
+// Layout of the shared memory segment
+typedef struct {
+    uint32_t magic;  // SHM_SNAPSHOT_MAGIC
+    uint32_t version;  // SHM_SNAPSHOT_VERSION
+    uint64_t seq;  // Seqlock counter: odd while a write is in progress
+    uint64_t words[SHM_SAMPLE_WORDS];  // SharedSample payload
+} SharedSegment;
+
+// Creates or reuses the named segment, locks it against other writers and maps it for writing
+SharedSegment *shm_snapshot_create(const char *name);
+
+// Publishes a sample into the segment under the seqlock
+void shm_snapshot_publish(SharedSegment *segment, const SharedSample *sample);
+
+// Unmaps the segment and removes its name
+void shm_snapshot_destroy(SharedSegment *segment, const char *name);
+
+// Maps an existing segment read-only; returns NULL with errno set on failure or if it is not ready
+const SharedSegment *shm_snapshot_open(const char *name);
+
+// Unmaps a segment obtained from shm_snapshot_open()
+void shm_snapshot_close(const SharedSegment *segment);
+
+/**
+ * Makes a single attempt at copying a consistent sample out of the segment.
+ *
+ * @param segment Segment mapped by shm_snapshot_open() or shm_snapshot_create().
+ * @param out Where to store the sample.
+ * @return 1 if the copy is consistent, 0 if it raced with the writer.
+ */
+static inline int shm_snapshot_try_read(const SharedSegment *segment, SharedSample *out) {
+    uint64_t words[SHM_SAMPLE_WORDS];
+
+    uint64_t seq_start = __atomic_load_n(&segment->seq, __ATOMIC_ACQUIRE);
+    if (seq_start & 1) {
+        return 0; // Writer is in the middle of an update
+    }
+    for (size_t i = 0; i < SHM_SAMPLE_WORDS; i++) {
+        words[i] = __atomic_load_n(&segment->words[i], __ATOMIC_RELAXED);
+    }
+    // Order the payload loads before the second look at the counter
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&segment->seq, __ATOMIC_RELAXED) != seq_start) {
+        return 0; // A write overlapped the copy
+    }
+    memcpy(out, words, sizeof(*out));
+    return 1;
+}
+
+/**
+ * Copies a consistent sample out of the segment, retrying while writes overlap the
+ * copy, at most SHM_SNAPSHOT_MAX_RETRIES times. Every SHM_SNAPSHOT_RETRIES_PER_YIELD
+ * retries it yields the CPU, in case the writer was preempted mid-publish on the same
+ * CPU. The counter stays odd for good if the writer died in the middle of a publish;
+ * the read then fails instead of spinning until a new writer reuses the segment.
+ *
+ * @param segment Segment mapped by shm_snapshot_open() or shm_snapshot_create().
+ * @param out Where to store the sample; left undefined on failure.
+ * @return Number of retries that were needed, or -1 with errno set to EAGAIN if no
+ *         consistent copy was obtained.
+ */
+static inline int shm_snapshot_read(const SharedSegment *segment, SharedSample *out) {
+    for (int retries = 0; retries <= SHM_SNAPSHOT_MAX_RETRIES; retries++) {
+        if (shm_snapshot_try_read(segment, out)) {
+            return retries;
+        }
+        if ((retries + 1) % SHM_SNAPSHOT_RETRIES_PER_YIELD == 0) {
+            sched_yield();
+        }
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+// End of the include guard
+#endif
@@ -1,6 +1,8 @@
 #define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include "stats_functions.h"
+#include "shm_snapshot.h"
+#include "collector.h"
 
 
 // Defining the long_options array here
@@ -11,6 +13,12 @@ static struct option long_options[] = {
     {"sequential",  no_argument,       0, 'q'},
     {"samples",     required_argument, 0, 'n'},
     {"tdelay",      required_argument, 0, 't'},
+    {"shm",         optional_argument, 0, 'm'},
+    {"record",      required_argument, 0, 'r'},
+    {"interrupts",  no_argument,       0, 'i'},
+    {"collect",     required_argument, 0, 'c'},
+    {"watch",       required_argument, 0, 'w'},
+    {"watch-name",  required_argument, 0, 'W'},
     {0, 0, 0, 0}  // Sentinel to mark the end of the array
 };
 
@@ -21,14 +29,9 @@ static struct option long_options[] = {
  *
  * argc: Number of arguments.
  * argv: Array of argument strings.
- * samples: Pointer to store the number of samples to take.
- * tdelay: Pointer to store the delay between samples.
- * system_flag: Pointer to flag indicating system stats collection.
- * user_flag: Pointer to flag indicating user stats collection.
- * graphics_flag: Pointer to flag indicating whether to display graphics.
- * sequential_flag: Pointer to flag indicating whether to run in sequential mode.
- */
-void parse_arguments(int argc, char *argv[], int *samples, int *tdelay, int *system_flag, int *user_flag, int *graphics_flag, int *sequential_flag) {
+ * options: Options to update; fields not mentioned on the command line keep their values.
+ */
+void parse_arguments(int argc, char *argv[], MonitorOptions *options) {
     // Initialization of variables for getopt_long
     int option_index = 0;
     int c;
@@ -36,26 +39,46 @@ void parse_arguments(int argc, char *argv[], int *samples, int *tdelay, int *sys
     int tdelay_flag = 0;
 
     // Loop through each argument and set flags or values based on the options
-    while ((c = getopt_long(argc, argv, "sugqn::t::", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "sugqin::t::m::r:c:w:W:", long_options, &option_index)) != -1) {
         switch (c) {
             // Set flags based on the command line options
-            case 's': *system_flag = 1; break;
-            case 'u': *user_flag = 1; break;
-            case 'g': *graphics_flag = 1; break;
-            case 'q': *sequential_flag = 1; break;
+            case 's': options->system_flag = 1; break;
+            case 'u': options->user_flag = 1; break;
+            case 'g': options->graphics_flag = 1; break;
+            case 'q': options->sequential_flag = 1; break;
+            case 'i': options->irq_flag = 1; break;
             // Set samples and tdelay based on provided values or defaults
             case 'n': 
                 if (optarg) {
-                    *samples = atoi(optarg);
+                    options->samples = atoi(optarg);
                     samples_flag = 1;
                 }
                 break;
             case 't': 
                 if (optarg) {
-                    *tdelay = atoi(optarg);
+                    options->tdelay = atof(optarg);
                     tdelay_flag = 1;
                 }
                 break;
+            // Publish samples to shared memory, under the given name or the default one
+            case 'm':
+                options->shm_name = optarg ? optarg : SHM_SNAPSHOT_DEFAULT_NAME;
+                break;
+            // Record every sample to a compressed time-series file
+            case 'r':
+                options->record_path = optarg;
+                break;
+            // Comma-separated list of collectors to display
+            case 'c':
+                options->collect_list = optarg;
+                break;
+            // Processes to watch, by PID list or by name pattern
+            case 'w':
+                options->watch_pids = optarg;
+                break;
+            case 'W':
+                options->watch_name = optarg;
+                break;
         }
     }
 
@@ -65,12 +88,12 @@ void parse_arguments(int argc, char *argv[], int *samples, int *tdelay, int *sys
         switch (index) {
             case 0: // First positional argument corresponds to 'samples'
                 if (!samples_flag) {
-                    *samples = atoi(argv[pa]);
+                    options->samples = atoi(argv[pa]);
                 }
                 break;
             case 1: // Second positional argument corresponds to 'tdelay'
                 if (!tdelay_flag) {
-                    *tdelay = atoi(argv[pa]);
+                    options->tdelay = atof(argv[pa]);
                 }
                 break;
         }
@@ -82,24 +105,25 @@ void parse_arguments(int argc, char *argv[], int *samples, int *tdelay, int *sys
  * ----------------------------
  * Displays the header information for each sample, including the iteration or total samples and delay.
  *
+ * out: Stream to print to.
  * sample_number: The current sample number being processed.
  * samples: Total number of samples to take.
- * tdelay: Delay between samples.
+ * tdelay: Delay between samples in seconds.
  * sequential_flag: Flag indicating whether to run in sequential mode.
  * system_flag: Flag indicating system stats collection.
  */
-void display_header(int sample_number, int samples, int tdelay, int sequential_flag, int system_flag) {
+void display_header(FILE *out, int sample_number, int samples, double tdelay, int sequential_flag, int system_flag) {
     struct rusage r_usage;
     // Get resource usage to display memory usage of the tool itself
     getrusage(RUSAGE_SELF, &r_usage);
     
     if (sequential_flag) {
-        printf(">>> iteration %d\n", sample_number);
+        fprintf(out, ">>> iteration %d\n", sample_number);
     } else {
-        printf("\033[H\033[2J"); // ANSI escape code to clear the screen
-        printf("Nbr of samples: %d -- every %d secs\n", samples, tdelay);
+        fprintf(out, "\033[H\033[2J"); // ANSI escape code to clear the screen
+        fprintf(out, "Nbr of samples: %d -- every %g secs\n", samples, tdelay);
     }
-    printf(" Memory usage: %ld kilobytes\n", r_usage.ru_maxrss);
+    fprintf(out, " Memory usage: %ld kilobytes\n", r_usage.ru_maxrss);
 }
 
 // memory stuff
@@ -128,29 +152,131 @@ void gather_memory_stats(MemoryStats *memory_stats_array, int index) {
     memory_stats_array[index].virt_total = (info.totalram + info.totalswap) * bytes_to_gb;
 }
 
+/*
+ * Function: pread_whole_file
+ * ----------------------------
+ * Reads a whole file, typically under /proc, from offset 0 through a descriptor kept open
+ * between samples, so re-reading it costs no open() or lseek(). The buffer is doubled until
+ * the file fits and the contents are NUL-terminated.
+ *
+ * fd: Descriptor of the file.
+ * buf: Heap buffer the file is read into; reallocated as it grows (may start as NULL).
+ * size: Capacity of *buf, updated when it grows.
+ *
+ * returns: The number of bytes read, or -1 with errno set if the read failed.
+ */
+ssize_t pread_whole_file(int fd, char **buf, size_t *size) {
+    size_t total = 0;
+    for (;;) {
+        if (*size < total + 2) {
+            *size = *size ? *size * 2 : 4096;
+            *buf = realloc(*buf, *size);
+            if (!*buf) {
+                perror("Failed to allocate read buffer");
+                exit(EXIT_FAILURE);
+            }
+        }
+        ssize_t n = pread(fd, *buf + total, *size - 1 - total, total);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    (*buf)[total] = '\0';
+    return total;
+}
+
+/*
+ * Function: print_change_bars
+ * ----------------------------
+ * Prints the bars representing a change between two samples: one '#' per unit of growth or
+ * one '@' per unit of shrinkage (at most 100), closed by '*', or a single 'o' when the change
+ * is smaller than one unit.
+ *
+ * out: Stream to print to.
+ * diff: The change since the previous sample.
+ * unit: The change represented by one bar.
+ */
+void print_change_bars(FILE *out, double diff, double unit) {
+    int bars = fabs(diff) / unit; // Calculate the number of bars to represent the change
+    fprintf(out, "   |");
+    if (diff >= unit) {
+        for (int j = 0; j < bars && j < 100; j++) fprintf(out, "#");
+        fprintf(out, "*");
+    } else if (diff <= -unit) {
+        for (int j = 0; j < bars && j < 100; j++) fprintf(out, "@");
+        fprintf(out, "*");
+    } else {
+        fprintf(out, "o");
+    }
+}
+
 /*
  * Function: append_graphical_representation
  * ----------------------------
  * Appends a graphical representation based on the difference between the current and previous virtual memory usage.
  *
+ * out: Stream to print to.
  * diff: The difference in virtual memory usage.
  * currentVirtUsed: The current virtual memory usage.
  * prev_virt: Pointer to the previous virtual memory usage, to be updated.
  */
-void append_graphical_representation(double diff, double currentVirtUsed, double *prev_virt) {
-    int bars = fabs(diff) * 100; // Calculate the number of bars to represent the change
-    printf("   |");
-    if (diff >= 0.01) {
-        for (int j = 0; j < bars && j < 100; j++) printf("#");
-        printf("*");
-    } else if (diff <= -0.01) {
-        for (int j = 0; j < bars && j < 100; j++) printf("@");
-        printf("*");
+void append_graphical_representation(FILE *out, double diff, double currentVirtUsed, double *prev_virt) {
+    print_change_bars(out, diff, 0.01); // One bar per 0.01 GB
+    fprintf(out, " %.2f (%.2f)", diff, currentVirtUsed);
+    *prev_virt = currentVirtUsed; // Update the previous virtual memory usage
+}
+
+/*
+ * Prints one paging value followed by its unit, or "n/a" for a counter the running
+ * kernel does not have, so it cannot be mistaken for no activity.
+ */
+static void print_paging_value(FILE *out, double value, const char *unit) {
+    if (isnan(value)) {
+        fprintf(out, "n/a");
     } else {
-        printf("o");
+        fprintf(out, "%.0f%s", value, unit);
     }
-    printf(" %.2f (%.2f)", diff, currentVirtUsed);
-    *prev_virt = currentVirtUsed; // Update the previous virtual memory usage
+}
+
+/*
+ * Function: print_paging_rates
+ * ----------------------------
+ * Appends the paging, reclaim and swap activity of one sample to a memory line: page faults
+ * and major faults, pages swapped in/out, pages scanned and stolen by kswapd/direct reclaim
+ * (all per second) and the number of OOM kills. Counters missing on the running kernel
+ * are shown as n/a.
+ *
+ * out: Stream to print to.
+ * paging: The rates of the sample.
+ */
+void print_paging_rates(FILE *out, const VmstatRates *paging) {
+    if (!paging->valid) {
+        fprintf(out, " -- paging n/a");
+        return;
+    }
+    const double *rates = paging->rates;
+    fprintf(out, " -- flt ");
+    print_paging_value(out, rates[VMSTAT_PGFAULT], "/s");
+    fprintf(out, " maj ");
+    print_paging_value(out, rates[VMSTAT_PGMAJFAULT], "/s");
+    fprintf(out, " swp in/out ");
+    print_paging_value(out, rates[VMSTAT_PSWPIN], "");
+    fprintf(out, "/");
+    print_paging_value(out, rates[VMSTAT_PSWPOUT], "");
+    fprintf(out, " scan k/d ");
+    print_paging_value(out, rates[VMSTAT_PGSCAN_KSWAPD], "");
+    fprintf(out, "/");
+    print_paging_value(out, rates[VMSTAT_PGSCAN_DIRECT], "");
+    fprintf(out, " steal k/d ");
+    print_paging_value(out, rates[VMSTAT_PGSTEAL_KSWAPD], "");
+    fprintf(out, "/");
+    print_paging_value(out, rates[VMSTAT_PGSTEAL_DIRECT], "");
+    fprintf(out, " oom ");
+    print_paging_value(out, round(rates[VMSTAT_OOM_KILL] * paging->elapsed), "");
 }
 
 /*
@@ -158,43 +284,51 @@ void append_graphical_representation(double diff, double currentVirtUsed, double
  * ----------------------------
  * Displays the memory statistics for either the current sample (sequential mode) or all samples up to the current one.
  *
+ * out: Stream to print to.
  * memory_stats_array: Array containing memory statistics.
+ * paging_array: Array containing the paging activity of each sample, or NULL to leave it out.
  * samples: Total number of samples.
  * currentSample: The current sample index being processed.
  * sequential: Flag indicating whether to run in sequential mode.
  * graphics_flag: Flag indicating whether to display graphical representation.
  * prev_virt: Pointer to the previous virtual memory usage.
  */
-void display_memory_stats(MemoryStats *memory_stats_array, int samples, int currentSample, int sequential, int graphics_flag, double *prev_virt) {
-    printf("### Memory ### (Phys.Used/Tot -- Virtual Used/Tot)\n");
+void display_memory_stats(FILE *out, MemoryStats *memory_stats_array, const VmstatRates *paging_array, int samples, int currentSample, int sequential, int graphics_flag, double *prev_virt) {
+    fprintf(out, "### Memory ### (Phys.Used/Tot -- Virtual Used/Tot%s)\n", paging_array ? " -- Paging" : "");
 
     if (sequential) {
         // In sequential mode, display stats for the current sample only
         for (int i = 0; i < samples; ++i) {
             if (i == currentSample) {
                 double diff = (i == 0) ? 0 : memory_stats_array[i].virt_used - *prev_virt;
-                printf("%.2f GB / %.2f GB -- %.2f GB / %.2f GB", memory_stats_array[i].phys_used, memory_stats_array[i].phys_total, memory_stats_array[i].virt_used, memory_stats_array[i].virt_total);
+                fprintf(out, "%.2f GB / %.2f GB -- %.2f GB / %.2f GB", memory_stats_array[i].phys_used, memory_stats_array[i].phys_total, memory_stats_array[i].virt_used, memory_stats_array[i].virt_total);
+                if (paging_array) {
+                    print_paging_rates(out, &paging_array[i]);
+                }
                 if (graphics_flag) {
-                    append_graphical_representation(diff, memory_stats_array[i].virt_used, prev_virt);
+                    append_graphical_representation(out, diff, memory_stats_array[i].virt_used, prev_virt);
                 }
-                printf("\n");
+                fprintf(out, "\n");
             } else {
-                printf("\n");
+                fprintf(out, "\n");
             }
         }
     } else {
         // In non-sequential mode, display stats for all samples up to the current one
         for (int i = 0; i <= currentSample; ++i) {
             double diff = (i == 0) ? 0 : memory_stats_array[i].virt_used - memory_stats_array[i - 1].virt_used;
-            printf("%.2f GB / %.2f GB -- %.2f GB / %.2f GB", memory_stats_array[i].phys_used, memory_stats_array[i].phys_total, memory_stats_array[i].virt_used, memory_stats_array[i].virt_total);
+            fprintf(out, "%.2f GB / %.2f GB -- %.2f GB / %.2f GB", memory_stats_array[i].phys_used, memory_stats_array[i].phys_total, memory_stats_array[i].virt_used, memory_stats_array[i].virt_total);
+            if (paging_array) {
+                print_paging_rates(out, &paging_array[i]);
+            }
             if (graphics_flag) {
-                append_graphical_representation(diff, memory_stats_array[i].virt_used, prev_virt);
+                append_graphical_representation(out, diff, memory_stats_array[i].virt_used, prev_virt);
             }
-            printf("\n");
+            fprintf(out, "\n");
         }
         // Fill with new lines for the remaining samples
         for (int i = currentSample + 1; i < samples; ++i) {
-            printf("\n");
+            fprintf(out, "\n");
         }
     }
     // Update prev_virt for the next iteration
@@ -203,14 +337,15 @@ void display_memory_stats(MemoryStats *memory_stats_array, int samples, int curr
     }
 }
 
-
 // CPU stuff
 /**
  * @brief Retrieves and prints the number of online processor cores in the system.
+ *
+ * @param out Stream to print to.
  */
-void get_cpu_cores() {
+void get_cpu_cores(FILE *out) {
     long n_processors = sysconf(_SC_NPROCESSORS_ONLN); // Get the number of online processors
-    printf("Number of cores: %ld\n", n_processors);
+    fprintf(out, "Number of cores: %ld\n", n_processors);
 }
 
 /**
@@ -257,9 +392,55 @@ void get_cpu_idle_total_times(unsigned long *idle_time, unsigned long *total_tim
     *total_time = times[0] + times[1] + times[2] + times[3] + times[4] + times[5] + times[6];
 }
 
+/**
+ * Reads the per-core "cpuN" lines of /proc/stat and extracts the idle and total
+ * CPU times of each core, using the same seven fields as get_cpu_idle_total_times().
+ *
+ * @param idle_times Array receiving the idle time of core N at index N.
+ * @param total_times Array receiving the total time of core N at index N.
+ * @param max_cores Capacity of both arrays.
+ * @return One past the highest core index read, i.e. the number of entries filled.
+ */
+int get_per_core_idle_total_times(unsigned long *idle_times, unsigned long *total_times, int max_cores) {
+    unsigned long times[7];
+    char buffer[1024];
+    int cores = 0;
+
+    FILE *fp = fopen("/proc/stat", "r");
+    if (!fp) {
+        perror("Failed to open /proc/stat");
+        exit(EXIT_FAILURE);
+    }
+
+    // Offline cores have no line, so leave their slots at zero
+    memset(idle_times, 0, max_cores * sizeof(*idle_times));
+    memset(total_times, 0, max_cores * sizeof(*total_times));
+
+    while (fgets(buffer, sizeof(buffer), fp)) {
+        int core;
+        // The aggregate "cpu " line does not match "cpu%d"; per-core lines end the cpu block
+        if (strncmp(buffer, "cpu", 3) != 0) {
+            break;
+        }
+        if (sscanf(buffer, "cpu%d %lu %lu %lu %lu %lu %lu %lu", &core,
+                   &times[0], &times[1], &times[2], &times[3],
+                   &times[4], &times[5], &times[6]) != 8 || core < 0 || core >= max_cores) {
+            continue;
+        }
+        idle_times[core] = times[3];
+        total_times[core] = times[0] + times[1] + times[2] + times[3] + times[4] + times[5] + times[6];
+        if (core + 1 > cores) {
+            cores = core + 1;
+        }
+    }
+
+    fclose(fp);
+    return cores;
+}
+
 
 /**
- * Calculates and prints the CPU usage percentage based on start and end idle/total times.
+ * Calculates the CPU usage percentage based on start and end idle/total times.
  *
  * @param idle_start Starting idle CPU time.
  * @param idle_end Ending idle CPU time.
@@ -267,8 +448,8 @@ void get_cpu_idle_total_times(unsigned long *idle_time, unsigned long *total_tim
  * @param total_end Ending total CPU time.
  * @return The calculated CPU usage percentage.
  */
-double calculate_and_print_cpu_usage(unsigned long idle_start, unsigned long idle_end, 
-                                     unsigned long total_start, unsigned long total_end) {
+double calculate_cpu_usage(unsigned long idle_start, unsigned long idle_end,
+                           unsigned long total_start, unsigned long total_end) {
     // Calculate the differences in total and idle times
     unsigned long total_diff = total_end - total_start;
     unsigned long idle_diff = idle_end - idle_start;
@@ -281,10 +462,7 @@ double calculate_and_print_cpu_usage(unsigned long idle_start, unsigned long idl
         // Calculate usage as a percentage of the non-idle time over total time
         cpu_usage = 100.0 * (total_diff - idle_diff) / total_diff;
     }
-
-    // Print the calculated CPU usage
-    printf(" total CPU use = %.2f%%\n", cpu_usage);
-    return cpu_usage; // Return the CPU usage value for potential further use
+    return cpu_usage;
 }
 
 /**
@@ -316,26 +494,27 @@ void update_cpu_graphics(double cpu_usage, int sample_index, char cpu_graphics_a
 /**
  * Prints the graphical representation of CPU usage for each sample up to the current one.
  *
+ * @param out Stream to print to.
  * @param currentSample The index of the current sample being processed.
  * @param sequential Whether the output should be in sequential mode or not.
  * @param cpu_graphics_arr The array holding graphical representations of CPU usage.
  * @param samples The total number of samples.
  */
-void print_cpu_graphics(int currentSample, int sequential, char cpu_graphics_arr[][1024], int samples) {
+void print_cpu_graphics(FILE *out, int currentSample, int sequential, char cpu_graphics_arr[][1024], int samples) {
     // Handle sequential and non-sequential modes of operation
     if (sequential) {
         // In sequential mode, print the graphic for the current sample only
         for (int i = 0; i <= currentSample; i++) {
             if (i == currentSample) {
-                printf("%s\n", cpu_graphics_arr[i]);
+                fprintf(out, "%s\n", cpu_graphics_arr[i]);
             } else {
-                printf("\n"); // Print empty lines for previous samples
+                fprintf(out, "\n"); // Print empty lines for previous samples
             }
         }
     } else {
         // In non-sequential mode, print the graphics for all samples up to the current one
         for (int i = 0; i <= currentSample; i++) {
-            printf("%s\n", cpu_graphics_arr[i]);
+            fprintf(out, "%s\n", cpu_graphics_arr[i]);
         }
     }
 }
@@ -379,76 +558,107 @@ void print_system_info() {
            days, hours, minutes, seconds, hours + (days * 24), minutes, seconds);
 }
 
-// launch memory 
+// memory collector
+
+// State of the memory collector: the history shown in every frame
+typedef struct {
+    MemoryStats *history;  // One entry per sample
+    VmstatRates *paging_history;  // Paging activity of each sample
+    VmstatReader *vmstat;  // Persistent reader of /proc/vmstat
+    int samples;  // Capacity of history
+    int sequential_flag;  // Output mode
+    int graphics_flag;  // Whether to append the virtual memory graphics
+    double prev_virt;  // Previous virtual memory usage, for the graphics
+} MemoryCollectorState;
 
 /**
- * Launches a child process to gather and report memory statistics back to the parent process.
- * The child process gathers memory statistics and writes them to a pipe.
- * The parent process reads these statistics from the pipe and displays them.
+ * Allocates the memory history for all samples and opens /proc/vmstat, taking the
+ * baseline of the first paging rates.
  *
- * @param pipefd Pipe file descriptor array used for interprocess communication.
- * @param memory_stats_array Array to store memory statistics.
- * @param samples Total number of samples to be taken.
- * @param currentSample Index of the current sample being processed.
- * @param sequential_flag Flag indicating if output should be sequential.
- * @param graphics_flag Flag indicating if graphical representation is enabled.
- * @param prev_virt Pointer to the previous virtual memory usage, used for graphical representation.
- */
-void launchMemoryStatsProcess(int pipefd[2], MemoryStats *memory_stats_array, int samples, 
-                              int currentSample, int sequential_flag, int graphics_flag, 
-                              double *prev_virt) {
-    pid_t cpid; // Child process ID
-    char buffer[1024]; // Buffer to hold formatted memory stats data
-
-    // Forking the process
-    cpid = fork();
-    if (cpid == -1) {
-        perror("fork");
+ * @param options Program options.
+ * @param slot_size Receives the size of a slot (one MemorySample).
+ * @return The collector state.
+ */
+static void *memory_collector_init(const MonitorOptions *options, size_t *slot_size) {
+    MemoryCollectorState *state = calloc(1, sizeof(MemoryCollectorState));
+    if (state) {
+        state->history = calloc(options->samples > 0 ? options->samples : 1, sizeof(MemoryStats));
+        state->paging_history = calloc(options->samples > 0 ? options->samples : 1, sizeof(VmstatRates));
+    }
+    if (!state || !state->history || !state->paging_history) {
+        perror("Failed to allocate memory collector");
         exit(EXIT_FAILURE);
     }
-    
-    if (cpid == 0) { // Child process: gathers and sends memory stats
-        close(pipefd[0]); // Close unused read end of the pipe
-        gather_memory_stats(memory_stats_array, currentSample); // Gather stats
-        // Format stats into a string
-        snprintf(buffer, sizeof(buffer), "%.2f %.2f %.2f %.2f",
-                 memory_stats_array[currentSample].phys_used,
-                 memory_stats_array[currentSample].phys_total,
-                 memory_stats_array[currentSample].virt_used,
-                 memory_stats_array[currentSample].virt_total);
-        write(pipefd[1], buffer, strlen(buffer) + 1); // Send to parent
-        close(pipefd[1]); // Signal end of data
-        exit(EXIT_SUCCESS);
-    } else { // Parent process: reads and displays memory stats
-        close(pipefd[1]); // Close unused write end
-        read(pipefd[0], buffer, sizeof(buffer)); // Read data from child
-        // Optionally parse received data into the memory_stats_array
-        sscanf(buffer, "%lf %lf %lf %lf",
-               &memory_stats_array[currentSample].phys_used,
-               &memory_stats_array[currentSample].phys_total,
-               &memory_stats_array[currentSample].virt_used,
-               &memory_stats_array[currentSample].virt_total);
-        display_memory_stats(memory_stats_array, samples, currentSample, 
-                             sequential_flag, graphics_flag, prev_virt); // Display stats
-        close(pipefd[0]); // Close read end
-        wait(NULL); // Wait for child to finish
-    }
-}
-
-// launch user
+    state->samples = options->samples;
+    state->sequential_flag = options->sequential_flag;
+    state->graphics_flag = options->graphics_flag;
+    state->vmstat = vmstat_open();
+    *slot_size = sizeof(MemorySample);
+    return state;
+}
+
+/**
+ * Gathers the memory statistics and the paging rates since the previous sample into the slot.
+ *
+ * @param state Collector state.
+ * @param slot MemorySample to fill.
+ */
+static void memory_collector_sample(void *state, void *slot) {
+    MemoryCollectorState *memory = state;
+    MemorySample *sample = slot;
+    gather_memory_stats(&sample->stats, 0);
+    vmstat_sample(memory->vmstat, &sample->paging);
+}
+
+/**
+ * Adds the sampled statistics to the history and displays it.
+ *
+ * @param out Stream to print to.
+ * @param state Collector state.
+ * @param slot Sampled MemorySample.
+ * @param sample_index Index of the current sample.
+ */
+static void memory_collector_render(FILE *out, void *state, const void *slot, int sample_index) {
+    MemoryCollectorState *memory = state;
+    const MemorySample *sample = slot;
+    memory->history[sample_index] = sample->stats;
+    memory->paging_history[sample_index] = sample->paging;
+    display_memory_stats(out, memory->history, memory->paging_history, memory->samples, sample_index,
+                         memory->sequential_flag, memory->graphics_flag, &memory->prev_virt);
+}
+
+/**
+ * Frees the memory history and closes /proc/vmstat.
+ *
+ * @param state Collector state.
+ */
+static void memory_collector_teardown(void *state) {
+    MemoryCollectorState *memory = state;
+    free(memory->history);
+    free(memory->paging_history);
+    vmstat_close(memory->vmstat);
+    free(memory);
+}
+
+const Collector memory_collector = {
+    "memory", memory_collector_init, memory_collector_sample, memory_collector_render, NULL, memory_collector_teardown
+};
+
+// user sessions
 
 /**
  * Prints the list of users.
  * Iterates through the linked list of UserNode, printing each user's details.
  * 
+ * @param out Stream to print to.
  * @param head Pointer to the head of the linked list of users.
  */
-void print_user_list(UserNode *head) {
+void print_user_list(FILE *out, UserNode *head) {
     UserNode *current = head; // Pointer to traverse the linked list
-    printf("### Sessions/users ###\n");
+    fprintf(out, "### Sessions/users ###\n");
     // Loop through the linked list and print user details
     while (current != NULL) {
-        printf("%s\t%s\t(%s)\n", current->username, current->utmp_line, current->hostname);
+        fprintf(out, "%s\t%s\t(%s)\n", current->username, current->utmp_line, current->hostname);
         current = current->next; // Move to the next node
     }
 }
@@ -471,6 +681,20 @@ void free_user_list(UserNode *head) {
     }
 }
 
+/**
+ * Counts the user sessions in the list.
+ *
+ * @param head Pointer to the head of the linked list of users.
+ * @return Number of nodes in the list.
+ */
+int count_user_list(UserNode *head) {
+    int count = 0;
+    for (UserNode *current = head; current != NULL; current = current->next) {
+        count++;
+    }
+    return count;
+}
+
 /**
  * Appends a new user to the end of the user list.
  * Dynamically allocates memory for a new UserNode, sets its details,
@@ -511,133 +735,213 @@ UserNode* append_user(UserNode* head, const char* username, const char* utmp_lin
 }
 
 /**
- * Launches a process to gather and report user statistics.
- * Utilizes a pipe to communicate user statistics from a forked child process
- * back to the parent process. It reads from utmp to list active users,
- * then appends each user to a linked list which is returned.
- * 
- * @param pipefd An array of two integers used as file descriptors for the pipe.
- * @return Head pointer to the linked list of users (UserNode*).
+ * Reads utmp and builds a linked list of the active user sessions.
+ *
+ * @return Head pointer to the linked list of users (UserNode*), NULL if there are none.
  */
-UserNode* launchUserStatsProcess(int pipefd[2]) {
-    pid_t cpid; // PID of the child process
-
-    // Create a pipe and handle failure
-    if (pipe(pipefd) == -1) {
-        perror("pipe");
-        exit(EXIT_FAILURE);
-    }
-
-    // Fork the process
-    cpid = fork();
-    if (cpid == -1) {
-        perror("fork");
-        exit(EXIT_FAILURE);
-    }
-
-    if (cpid == 0) { // In child process
-        close(pipefd[0]); // Close read end; not used by child
-
-        // Begin reading user entries
-        struct utmp* u;
-        setutent(); // Rewind to the start of utmp file
-        FILE* stream = fdopen(pipefd[1], "w"); // Open write-end of pipe as a file
-
-        // Read each user entry and write to pipe
-        while ((u = getutent()) != NULL) {
-            if (u->ut_type == USER_PROCESS) {
-                fprintf(stream, "%s %s %s\n", u->ut_user, u->ut_line, u->ut_host);
-            }
+UserNode* gather_user_sessions(void) {
+    UserNode* head = NULL; // Head of the users linked list
+    struct utmp* u;
+
+    setutent(); // Rewind to the start of utmp file
+    while ((u = getutent()) != NULL) {
+        if (u->ut_type == USER_PROCESS) {
+            head = append_user(head, u->ut_user, u->ut_line, u->ut_host);
         }
-        endutent(); // Close utmp file
-        fclose(stream); // Close stream and pipe write-end, then exit
-        exit(EXIT_SUCCESS);
-    } else { // In parent process
-        close(pipefd[1]); // Close write end; not used by parent
-        FILE* stream = fdopen(pipefd[0], "r"); // Open read-end of pipe as a file
-
-        UserNode* head = NULL; // Head of the users linked list
-        char username[256], utmp_line[32], hostname[256];
-
-        // Read user data from pipe and append to linked list
-        while (fscanf(stream, "%255s %31s %255s\n", username, utmp_line, hostname) == 3) {
-            head = append_user(head, username, utmp_line, hostname);
-        }
-
-        fclose(stream); // Close stream and read-end of pipe
-        wait(NULL); // Wait for child to finish
-
-        return head; // Return head of the linked list
     }
+    endutent(); // Close utmp file
+    return head;
 }
 
-// launch cpu
-
+// users collector
 
 /**
- * Launches a process to calculate and report CPU usage statistics.
- * Forks a child process to gather CPU usage data, which is then sent back
- * to the parent process via a pipe. The CPU usage is calculated based on 
- * idle and total times at the start and end of an interval.
- * 
- * @param pipefd Array of two integers for the pipe's file descriptors.
- * @param idle_start Idle CPU time at the start of the interval.
- * @param total_start Total CPU time at the start of the interval.
- * @param graphics_flag Flag indicating if graphics mode is enabled.
- * @param sample_index Index of the current sample in the monitoring cycle.
- * @param cpu_graphics_arr Array storing graphical representation of CPU usage.
- * @param samples Total number of samples to be taken.
- * @param sequential_flag Flag indicating if output is sequential.
- */
-void launchCpuStatsProcess(int pipefd[2], unsigned long idle_start, unsigned long total_start, int graphics_flag, int sample_index, char cpu_graphics_arr[][1024], int samples, int sequential_flag) {
-    pid_t cpid; // PID of the child process
-    char buffer[256]; // Buffer to store CPU usage data
-
-    // Fork the process
-    cpid = fork();
-    if (cpid == -1) {
-        perror("fork");
-        exit(EXIT_FAILURE);
+ * The users collector keeps no state of its own. A test build (SYS_STATS_TESTING)
+ * reads sessions from the utmp file named by SYS_STATS_UTMP, if set, so the load
+ * harness can feed it known sessions.
+ *
+ * @param options Program options (unused).
+ * @param slot_size Receives the size of a slot (one UserSample).
+ * @return NULL.
+ */
+static void *users_collector_init(const MonitorOptions *options, size_t *slot_size) {
+    (void)options;
+#ifdef SYS_STATS_TESTING
+    const char *utmp_path = getenv("SYS_STATS_UTMP");
+    if (utmp_path) {
+        utmpname(utmp_path);
     }
+#endif
+    *slot_size = sizeof(UserSample);
+    return NULL;
+}
 
-    if (cpid == 0) { // In child process
-        close(pipefd[0]); // Close read end; not used by child
+/**
+ * Replaces the session list held by the slot with a fresh one.
+ *
+ * @param state Collector state (unused).
+ * @param slot UserSample to fill.
+ */
+static void users_collector_sample(void *state, void *slot) {
+    (void)state;
+    UserSample *users = slot;
+    free_user_list(users->head);
+    users->head = gather_user_sessions();
+    users->count = count_user_list(users->head);
+}
 
-        // Gather CPU stats at the end of the interval
-        unsigned long idle_end, total_end;
-        get_cpu_idle_total_times(&idle_end, &total_end);
+/**
+ * Prints the sampled session list.
+ *
+ * @param out Stream to print to.
+ * @param state Collector state (unused).
+ * @param slot Sampled UserSample.
+ * @param sample_index Index of the current sample (unused).
+ */
+static void users_collector_render(FILE *out, void *state, const void *slot, int sample_index) {
+    (void)state;
+    (void)sample_index;
+    print_user_list(out, ((const UserSample *)slot)->head);
+}
 
-        // Calculate CPU usage based on idle and total time differences
-        double cpu_usage = calculate_and_print_cpu_usage(idle_start, idle_end, total_start, total_end);
+/**
+ * Frees the session list held by a slot.
+ *
+ * @param slot UserSample to release.
+ */
+static void users_collector_release(void *slot) {
+    free_user_list(((UserSample *)slot)->head);
+}
 
-        // Send CPU usage to the parent process
-        snprintf(buffer, sizeof(buffer), "%.2f", cpu_usage);
-        write(pipefd[1], buffer, strlen(buffer));
+/**
+ * Does nothing: the users collector has no state.
+ *
+ * @param state Collector state (unused).
+ */
+static void users_collector_teardown(void *state) {
+    (void)state;
+}
 
-        close(pipefd[1]); // Close write end of the pipe and exit
-        exit(EXIT_SUCCESS);
-    } else { // In parent process
-        close(pipefd[1]); // Close write end; not used by parent
+const Collector users_collector = {
+    "users", users_collector_init, users_collector_sample, users_collector_render,
+    users_collector_release, users_collector_teardown
+};
 
-        // Wait for the child process to complete
-        wait(NULL);
+// CPU collector
 
-        // Read CPU usage data sent by the child process
-        read(pipefd[0], buffer, sizeof(buffer));
-        double cpu_usage;
-        sscanf(buffer, "%lf", &cpu_usage);
+// State of the CPU collector: the previous CPU times and the graphics history
+typedef struct {
+    unsigned long idle, total;  // CPU times at the previous sample
+    int n_cores;  // Cores tracked individually (0 unless recording)
+    unsigned long *core_idle, *core_total;  // Per-core times at the previous sample
+    unsigned long *core_idle_end, *core_total_end;  // Scratch for the current sample
+    char (*graphics)[1024];  // One graphics line per sample
+    int samples;  // Total number of samples
+    int graphics_flag;  // Whether to print the graphics
+    int sequential_flag;  // Output mode
+} CpuCollectorState;
 
-        // Update and print CPU graphics if enabled
-        if (graphics_flag) {
-            update_cpu_graphics(cpu_usage, sample_index, cpu_graphics_arr, samples);
-            print_cpu_graphics(sample_index, sequential_flag, cpu_graphics_arr, samples);
-        }
+/**
+ * Takes the first CPU times, which the first sample is measured against. Per-core
+ * times are only tracked when a recording needs them.
+ *
+ * @param options Program options.
+ * @param slot_size Receives the size of a slot (CpuSample plus one double per core).
+ * @return The collector state.
+ */
+static void *cpu_collector_init(const MonitorOptions *options, size_t *slot_size) {
+    CpuCollectorState *state = calloc(1, sizeof(CpuCollectorState));
+    if (!state) {
+        perror("Failed to allocate CPU collector");
+        exit(EXIT_FAILURE);
+    }
+    state->samples = options->samples;
+    state->graphics_flag = options->graphics_flag;
+    state->sequential_flag = options->sequential_flag;
+    state->graphics = calloc(options->samples > 0 ? options->samples : 1, sizeof(*state->graphics));
+    if (options->record_path) {
+        state->n_cores = sysconf(_SC_NPROCESSORS_CONF);
+    }
+    state->core_idle = calloc(state->n_cores + 1, sizeof(unsigned long));
+    state->core_total = calloc(state->n_cores + 1, sizeof(unsigned long));
+    state->core_idle_end = calloc(state->n_cores + 1, sizeof(unsigned long));
+    state->core_total_end = calloc(state->n_cores + 1, sizeof(unsigned long));
+    if (!state->graphics || !state->core_idle || !state->core_total || !state->core_idle_end || !state->core_total_end) {
+        perror("Failed to allocate CPU collector");
+        exit(EXIT_FAILURE);
+    }
 
-        close(pipefd[0]); // Close read end of the pipe
+    get_cpu_idle_total_times(&state->idle, &state->total);
+    if (state->n_cores > 0) {
+        get_per_core_idle_total_times(state->core_idle, state->core_total, state->n_cores);
     }
+    *slot_size = sizeof(CpuSample) + state->n_cores * sizeof(double);
+    return state;
 }
 
+/**
+ * Computes the CPU usage since the previous sample (or since init for the first one).
+ *
+ * @param state Collector state.
+ * @param slot CpuSample to fill.
+ */
+static void cpu_collector_sample(void *state, void *slot) {
+    CpuCollectorState *cpu = state;
+    CpuSample *sample = slot;
+    unsigned long idle_end, total_end;
+
+    get_cpu_idle_total_times(&idle_end, &total_end);
+    sample->usage = calculate_cpu_usage(cpu->idle, idle_end, cpu->total, total_end);
+    cpu->idle = idle_end;
+    cpu->total = total_end;
+
+    sample->n_cores = cpu->n_cores;
+    if (cpu->n_cores > 0) {
+        get_per_core_idle_total_times(cpu->core_idle_end, cpu->core_total_end, cpu->n_cores);
+        for (int core = 0; core < cpu->n_cores; core++) {
+            sample->core_usage[core] = calculate_cpu_usage(cpu->core_idle[core], cpu->core_idle_end[core],
+                                                           cpu->core_total[core], cpu->core_total_end[core]);
+            cpu->core_idle[core] = cpu->core_idle_end[core];
+            cpu->core_total[core] = cpu->core_total_end[core];
+        }
+    }
+}
 
+/**
+ * Prints the number of cores, the CPU usage and, if enabled, the usage graphics.
+ *
+ * @param out Stream to print to.
+ * @param state Collector state.
+ * @param slot Sampled CpuSample.
+ * @param sample_index Index of the current sample.
+ */
+static void cpu_collector_render(FILE *out, void *state, const void *slot, int sample_index) {
+    CpuCollectorState *cpu = state;
+    double cpu_usage = ((const CpuSample *)slot)->usage;
+
+    get_cpu_cores(out);
+    fprintf(out, " total CPU use = %.2f%%\n", cpu_usage);
+    if (cpu->graphics_flag) {
+        update_cpu_graphics(cpu_usage, sample_index, cpu->graphics, cpu->samples);
+        print_cpu_graphics(out, sample_index, cpu->sequential_flag, cpu->graphics, cpu->samples);
+    }
+}
 
+/**
+ * Frees the CPU collector state.
+ *
+ * @param state Collector state.
+ */
+static void cpu_collector_teardown(void *state) {
+    CpuCollectorState *cpu = state;
+    free(cpu->graphics);
+    free(cpu->core_idle);
+    free(cpu->core_total);
+    free(cpu->core_idle_end);
+    free(cpu->core_total_end);
+    free(cpu);
+}
 
-
+const Collector cpu_collector = {
+    "cpu", cpu_collector_init, cpu_collector_sample, cpu_collector_render, NULL, cpu_collector_teardown
+};
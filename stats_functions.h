@@ -16,6 +16,7 @@
 #include <math.h>
 #include <sys/wait.h>  // For wait() in process handling
 #include <signal.h>  // For signal handling
+#include "vmstat_stats.h"  // For paging activity
 
 // Macro to compute the minimum of two values
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
@@ -36,56 +37,81 @@ typedef struct UserNode {
     struct UserNode *next;  // Pointer to next node in the list
 } UserNode;
 
+// Options taken from the command line
+typedef struct {
+    int samples;  // Number of samples to take
+    double tdelay;  // Delay between samples in seconds (may be fractional)
+    int system_flag;  // --system: show system usage only
+    int user_flag;  // --user: show user sessions only
+    int graphics_flag;  // --graphics: append graphics to memory and CPU
+    int sequential_flag;  // --sequential: print iterations one after another
+    int irq_flag;  // --interrupts: also show interrupt and softirq rates
+    const char *collect_list;  // --collect: comma-separated collectors to display, or NULL
+    const char *shm_name;  // --shm: shared memory segment to publish to, or NULL
+    const char *record_path;  // --record: recording to append to, or NULL
+    const char *watch_pids;  // --watch: comma-separated PIDs to track, or NULL
+    const char *watch_name;  // --watch-name: regex matched against process names, or NULL
+} MonitorOptions;
+
 
 
 
-// Parses command line arguments and sets corresponding flags
-void parse_arguments(int argc, char *argv[], int *samples, int *tdelay, int *system_flag, int *user_flag, int *graphics_flag, int *sequential_flag);
+// Parses command line arguments into the options
+void parse_arguments(int argc, char *argv[], MonitorOptions *options);
 
 // Displays the header information for each sample interval
-void display_header(int sample_number, int samples, int tdelay, int sequential_flag, int system_flag);
+void display_header(FILE *out, int sample_number, int samples, double tdelay, int sequential_flag, int system_flag);
 
 // Gathers and stores memory statistics into the provided array at the specified index
 void gather_memory_stats(MemoryStats *memory_stats_array, int index);
 
+// Reads a whole file through a persistent descriptor into a growing buffer
+ssize_t pread_whole_file(int fd, char **buf, size_t *size);
+
+// Prints bars for the change between two samples, one per unit of change
+void print_change_bars(FILE *out, double diff, double unit);
+
+// Appends the paging, reclaim and swap rates of one sample to a memory line
+void print_paging_rates(FILE *out, const VmstatRates *paging);
+
 // Displays memory statistics based on the array, considering sequential and graphics flags
-void display_memory_stats(MemoryStats *memory_stats_array, int samples, int currentSample, int sequential, int graphics_flag, double *prev_virt);
+void display_memory_stats(FILE *out, MemoryStats *memory_stats_array, const VmstatRates *paging_array, int samples, int currentSample, int sequential, int graphics_flag, double *prev_virt);
 
 // Retrieves and prints the number of CPU cores
-void get_cpu_cores(void);
+void get_cpu_cores(FILE *out);
 
 // Retrieves idle and total CPU times for calculating CPU usage
 void get_cpu_idle_total_times(unsigned long *idle_time, unsigned long *total_time);
 
-// Calculates and prints CPU usage between two time intervals
-double calculate_and_print_cpu_usage(unsigned long idle_start, unsigned long idle_end, unsigned long total_start, unsigned long total_end);
+// Retrieves idle and total CPU times of each core; returns the number of cores read
+int get_per_core_idle_total_times(unsigned long *idle_times, unsigned long *total_times, int max_cores);
+
+// Calculates CPU usage between two time intervals
+double calculate_cpu_usage(unsigned long idle_start, unsigned long idle_end, unsigned long total_start, unsigned long total_end);
 
 // Updates graphical representation of CPU usage
 void update_cpu_graphics(double cpu_usage, int sample_index, char cpu_graphics_arr[][1024], int samples);
 
 // Prints CPU usage graphics for all samples up to the current one
-void print_cpu_graphics(int currentSample, int sequential, char cpu_graphics_arr[][1024], int samples);
+void print_cpu_graphics(FILE *out, int currentSample, int sequential, char cpu_graphics_arr[][1024], int samples);
 
 // Prints system information such as OS version, machine name, and uptime
 void print_system_info(void);
 
-// Launches a process to gather and report memory stats, communicating via pipes
-void launchMemoryStatsProcess(int pipefd[2], MemoryStats *memory_stats_array, int samples, int currentSample, int sequential_flag, int graphics_flag, double *prev_virt);
-
 // Prints the list of user sessions
-void print_user_list(UserNode *head);
+void print_user_list(FILE *out, UserNode *head);
 
 // Frees the memory allocated for the user list
 void free_user_list(UserNode *head);
 
+// Counts the user sessions in the list
+int count_user_list(UserNode *head);
+
 // Appends a new user session to the list
 UserNode* append_user(UserNode* head, const char* username, const char* utmp_line, const char* hostname);
 
-// Launches a process to gather and report user session stats, communicating via pipes
-UserNode* launchUserStatsProcess(int pipefd[2]);
-
-// Launches a process to gather and report CPU stats, communicating via pipes, and optionally prints them
-void launchCpuStatsProcess(int pipefd[2], unsigned long idle_start, unsigned long total_start, int graphics_flag, int sample_index, char cpu_graphics_arr[][1024], int samples, int sequential_flag);
+// Reads utmp and returns the list of active user sessions
+UserNode* gather_user_sessions(void);
 
 // End of the include guard
 #endif
@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>  // For NAN
+#include <unistd.h>
+#include <fcntl.h>  // For open()
+#include <time.h>  // For clock_gettime()
+#include "vmstat_stats.h"
+#include "stats_functions.h"  // For pread_whole_file()
+
+// Initial read buffer size; grown by doubling when the file does not fit
+#define VMSTAT_INITIAL_BUF_SIZE 8192
+
+// Names of the tracked counters in /proc/vmstat, indexed by VmstatCounter
+static const char *const counter_names[VMSTAT_COUNTER_COUNT] = {
+    [VMSTAT_PGFAULT] = "pgfault",
+    [VMSTAT_PGMAJFAULT] = "pgmajfault",
+    [VMSTAT_PSWPIN] = "pswpin",
+    [VMSTAT_PSWPOUT] = "pswpout",
+    [VMSTAT_PGSCAN_KSWAPD] = "pgscan_kswapd",
+    [VMSTAT_PGSCAN_DIRECT] = "pgscan_direct",
+    [VMSTAT_PGSTEAL_KSWAPD] = "pgsteal_kswapd",
+    [VMSTAT_PGSTEAL_DIRECT] = "pgsteal_direct",
+    [VMSTAT_OOM_KILL] = "oom_kill",
+};
+
+/*
+ * Returns whether a line starts with the given counter name followed by a space.
+ */
+static int line_has_name(const char *line, VmstatCounter counter) {
+    size_t len = strlen(counter_names[counter]);
+    return strncmp(line, counter_names[counter], len) == 0 && line[len] == ' ';
+}
+
+/*
+ * Learns the line of every tracked counter by matching names against every line.
+ * Counters the kernel does not have are left out of by_line.
+ */
+static void learn_layout(VmstatReader *reader) {
+    for (int counter = 0; counter < VMSTAT_COUNTER_COUNT; counter++) {
+        reader->line_of[counter] = -1;
+    }
+    reader->n_present = 0;
+    int line = 0;
+    for (const char *p = reader->buf; *p; line++) {
+        for (int counter = 0; counter < VMSTAT_COUNTER_COUNT; counter++) {
+            if (reader->line_of[counter] == -1 && line_has_name(p, counter)) {
+                reader->line_of[counter] = line;
+                reader->by_line[reader->n_present++] = counter;
+                break;
+            }
+        }
+        const char *next = strchr(p, '\n');
+        p = next ? next + 1 : p + strlen(p);
+    }
+    reader->learned = 1;
+}
+
+/*
+ * Parses the tracked counters using the learned layout: walks the lines, stopping
+ * only at the cached ones, and checks each name in place. Returns -1 if a
+ * name is not where it was learned, 0 otherwise.
+ */
+static int parse_cached(VmstatReader *reader) {
+    const char *p = reader->buf;
+    int line = 0;
+    for (int k = 0; k < reader->n_present; k++) {
+        int counter = reader->by_line[k];
+        for (; line < reader->line_of[counter]; line++) {
+            p = strchr(p, '\n');
+            if (!p) {
+                return -1;
+            }
+            p++;
+        }
+        if (!line_has_name(p, counter)) {
+            return -1;
+        }
+        reader->values[counter] = strtoull(p + strlen(counter_names[counter]) + 1, NULL, 10);
+    }
+    return 0;
+}
+
+/**
+ * Opens /proc/vmstat, learns where the tracked counters are and reads them as the
+ * baseline of the first rates.
+ *
+ * @return The reader.
+ */
+VmstatReader *vmstat_open(void) {
+    VmstatReader *reader = calloc(1, sizeof(VmstatReader));
+    if (!reader) {
+        perror("Failed to allocate /proc/vmstat reader");
+        exit(EXIT_FAILURE);
+    }
+    reader->fd = open("/proc/vmstat", O_RDONLY);
+    if (reader->fd == -1) {
+        perror("/proc/vmstat");
+        exit(EXIT_FAILURE);
+    }
+    reader->buf_size = VMSTAT_INITIAL_BUF_SIZE;
+    reader->buf = malloc(reader->buf_size);
+    if (!reader->buf) {
+        perror("Failed to allocate /proc/vmstat buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    VmstatRates baseline;
+    vmstat_sample(reader, &baseline);
+    return reader;
+}
+
+/**
+ * Re-reads /proc/vmstat through the persistent descriptor and computes per-second
+ * rates against the previous read. Should the layout ever change, it is learned
+ * again and this sample only becomes the new baseline.
+ *
+ * @param reader Reader returned by vmstat_open().
+ * @param rates Receives the rates; rates->valid is 0 when none could be computed, and
+ *              counters the running kernel does not have are NaN.
+ */
+void vmstat_sample(VmstatReader *reader, VmstatRates *rates) {
+    unsigned long long prev_values[VMSTAT_COUNTER_COUNT];
+    struct timespec now;
+
+    memcpy(prev_values, reader->values, sizeof(prev_values));
+    if (pread_whole_file(reader->fd, &reader->buf, &reader->buf_size) < 0) {
+        perror("Failed to read /proc/vmstat");
+        exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    int had_baseline = reader->learned;
+    if (!reader->learned || parse_cached(reader) != 0) {
+        learn_layout(reader);
+        parse_cached(reader);
+        had_baseline = 0;
+    }
+
+    double now_seconds = now.tv_sec + now.tv_nsec / 1e9;
+    double elapsed = now_seconds - reader->last_read;
+    rates->valid = had_baseline && elapsed > 0;
+    rates->elapsed = elapsed;
+    for (int counter = 0; counter < VMSTAT_COUNTER_COUNT; counter++) {
+        if (reader->line_of[counter] == -1) {
+            rates->rates[counter] = NAN; // Not available on this kernel
+        } else {
+            rates->rates[counter] = rates->valid ? (reader->values[counter] - prev_values[counter]) / elapsed : 0.0;
+        }
+    }
+    reader->last_read = now_seconds;
+}
+
+/**
+ * Closes the descriptor and frees the reader.
+ *
+ * @param reader Reader returned by vmstat_open(); freed by this call.
+ */
+void vmstat_close(VmstatReader *reader) {
+    close(reader->fd);
+    free(reader->buf);
+    free(reader);
+}
@@ -0,0 +1,57 @@
+// Guard to prevent double inclusion of the header file
+#ifndef VMSTAT_STATS_H
+#define VMSTAT_STATS_H
+
+// Paging, reclaim and swap activity rates from /proc/vmstat.
+//
+// Only the counters below are parsed. The first read learns which line each of them
+// is on; later reads walk straight to those lines and only confirm the name there
+// before parsing the number, instead of matching every line of the file.
+
+#include <stddef.h>
+
+// The /proc/vmstat counters that are tracked
+typedef enum {
+    VMSTAT_PGFAULT,  // Page faults
+    VMSTAT_PGMAJFAULT,  // Major page faults (needed I/O)
+    VMSTAT_PSWPIN,  // Pages swapped in
+    VMSTAT_PSWPOUT,  // Pages swapped out
+    VMSTAT_PGSCAN_KSWAPD,  // Pages scanned by kswapd
+    VMSTAT_PGSCAN_DIRECT,  // Pages scanned by direct reclaim
+    VMSTAT_PGSTEAL_KSWAPD,  // Pages reclaimed by kswapd
+    VMSTAT_PGSTEAL_DIRECT,  // Pages reclaimed by direct reclaim
+    VMSTAT_OOM_KILL,  // Processes killed by the OOM killer
+    VMSTAT_COUNTER_COUNT  // Number of tracked counters
+} VmstatCounter;
+
+// Per-second rates of the tracked counters over one sample
+typedef struct {
+    int valid;  // 0 until a full interval has been measured
+    double elapsed;  // Length of the interval in seconds
+    double rates[VMSTAT_COUNTER_COUNT];  // Indexed by VmstatCounter; NaN if the kernel lacks the counter
+} VmstatRates;
+
+// Persistent reader of /proc/vmstat
+typedef struct {
+    int fd;  // Persistent descriptor on /proc/vmstat
+    char *buf;  // Read buffer, grown to fit the whole file
+    size_t buf_size;  // Capacity of buf
+    int learned;  // Whether line_of holds the layout of the file
+    int line_of[VMSTAT_COUNTER_COUNT];  // Line of each counter, -1 if the kernel lacks it
+    int by_line[VMSTAT_COUNTER_COUNT];  // Present counters in line order
+    int n_present;  // Entries in by_line
+    unsigned long long values[VMSTAT_COUNTER_COUNT];  // Counters of the latest read
+    double last_read;  // CLOCK_MONOTONIC time in seconds of the latest read
+} VmstatReader;
+
+// Opens /proc/vmstat and takes the baseline of the first rates
+VmstatReader *vmstat_open(void);
+
+// Re-reads the counters and computes their rates since the previous sample
+void vmstat_sample(VmstatReader *reader, VmstatRates *rates);
+
+// Closes the reader
+void vmstat_close(VmstatReader *reader);
+
+// End of the include guard
+#endif